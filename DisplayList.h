@@ -0,0 +1,292 @@
+#pragma once
+
+// Retained display list: every stored shape rasterized once, then replayed.
+//
+// A stored shape never changes once added, yet each repaint ran its
+// algorithm again from the stored parameters. A DisplayList keeps what that
+// run leaves instead. The shape is drawn once into scratch memory covering
+// its bounds on the canvas, and each row of the scratch is cut into runs of
+// one colour; replaying the entry writes those runs, clipped to the target.
+// Overdraw within a shape is resolved when it is compiled and no raster
+// routine reads the target, so replaying entries in painting order leaves
+// exactly the pixels drawing the shapes would.
+//
+// Prepare compiles the entries a frame is missing, several at a time on a
+// pool, before its tiles are drawn; the tiles then only read the list.
+// Lines are the one kind clipped against the active clip window, so their
+// entries are dropped whenever the window or the clipping method changes.
+// Points are a pixel each and are always drawn directly. A shape edited in
+// place needs Invalidate, and a cleared or reloaded scene needs Clear.
+//
+// Compiling draws into a box-sized scratch and reads all of it back, which
+// for a curve with a large box costs several times drawing it. A frame
+// therefore compiles only up to a set scratch area and draws its other
+// shapes directly; later frames pick them up. The runs themselves are held
+// under a byte budget. Past it the entries used least recently are
+// evicted; once the frame's own entries fill the budget, the rest of its
+// shapes are drawn directly rather than compiled.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <vector>
+#include "Scene.h"
+#include "ThreadPool.h"
+
+// length pixels from (x, y) to the right.
+struct DisplaySpan {
+    int y, x, length;
+};
+
+struct DisplayEntry {
+    int algorithm;        // the shape's algorithm (advanced shapes: their kind), -1 if it has none
+    PixelRect captured;   // the part of the shape's bounds that was drawn
+    bool uniform;         // every run is `pixel`; otherwise run i is pixels[i]
+    uint32_t pixel;
+    std::vector<DisplaySpan> spans; // by row, then x
+    std::vector<uint32_t> pixels;
+
+    size_t Bytes() const {
+        return sizeof(DisplayEntry) + spans.capacity() * sizeof(DisplaySpan) + pixels.capacity() * sizeof(uint32_t);
+    }
+};
+
+inline int ShapeAlgorithm(const Scene& scene, ShapeRef ref) {
+    switch (ref.kind) {
+    case SHAPE_LINES: return scene.lines.algorithm[ref.index];
+    case SHAPE_CIRCLES: return scene.circles.algorithm[ref.index];
+    case SHAPE_ELLIPSES: return scene.ellipses.algorithm[ref.index];
+    case SHAPE_ADVANCED: return scene.advanced.kind[ref.index];
+    default: return -1;
+    }
+}
+
+// Draws ref into e, limited to area (the canvas); w is the scene's
+// ActiveClipWindow.
+inline void CompileDisplayEntry(const Scene& scene, const ClipWindow& w, ShapeRef ref, const PixelRect& area,
+    DisplayEntry& e) {
+    static thread_local std::vector<uint32_t> scratch; // all transparent between calls
+    e.algorithm = ShapeAlgorithm(scene, ref);
+    e.captured = Intersect(ShapeBounds(scene, ref), area);
+    e.uniform = true;
+    e.pixel = 0;
+    e.spans.clear();
+    e.pixels.clear();
+    if (IsEmpty(e.captured)) return;
+
+    const PixelRect& box = e.captured;
+    int bw = box.right - box.left, bh = box.bottom - box.top;
+    if (scratch.size() < (size_t)bw * bh) scratch.resize((size_t)bw * bh, TransparentPixel);
+    // The scratch holds only the box, so the target starts at its corner.
+    RenderTarget rt = { scratch.data(), bw, bh, box, box.left, box.top };
+    DrawShape(rt, scene, w, ref);
+
+    for (int y = 0; y < bh; y++) {
+        const uint32_t* row = scratch.data() + (size_t)y * bw;
+        for (int x = 0; x < bw;) {
+            // only a transparent pixel has top bits, so eight are when their
+            // AND has them; most of a curve's box is
+            while (x + 8 <= bw && (row[x] & row[x + 1] & row[x + 2] & row[x + 3] & row[x + 4] & row[x + 5] &
+                row[x + 6] & row[x + 7]) == TransparentPixel)
+                x += 8;
+            if (x == bw) break;
+            uint32_t p = row[x];
+            if (p == TransparentPixel) {
+                x++;
+                continue;
+            }
+            int first = x;
+            while (++x < bw && row[x] == p) {}
+            DisplaySpan s = { box.top + y, box.left + first, x - first };
+            if (e.spans.empty()) e.pixel = p;
+            else if (p != e.pixel) e.uniform = false;
+            e.spans.push_back(s);
+            e.pixels.push_back(p);
+        }
+    }
+    // transparent again where the shape drew, rather than over the whole box
+    for (const DisplaySpan& s : e.spans)
+        FillPixels(scratch.data() + (size_t)(s.y - box.top) * bw + (s.x - box.left), (size_t)s.length, TransparentPixel);
+    if (e.uniform) e.pixels.clear();
+    e.spans.shrink_to_fit();
+    e.pixels.shrink_to_fit();
+}
+
+inline void ReplayDisplayEntry(RenderTarget& rt, const DisplayEntry& e) {
+    const PixelRect& clip = rt.clip;
+    if (!Intersects(e.captured, clip)) return;
+    auto begin = e.spans.begin();
+    auto it = std::lower_bound(begin, e.spans.end(), clip.top, [](const DisplaySpan& s, int y) { return s.y < y; });
+    for (; it != e.spans.end() && it->y < clip.bottom; ++it) {
+        int x1 = std::max(it->x, clip.left), x2 = std::min(it->x + it->length, clip.right);
+        if (x1 >= x2) continue;
+        uint32_t p = e.uniform ? e.pixel : e.pixels[it - begin];
+        FillPixels(PixelAt(rt, x1, it->y), (size_t)(x2 - x1), p);
+    }
+}
+
+
+// direct counts shapes drawn for want of room, deferred those drawn because
+// their frame had compiled enough already.
+struct DisplayListStats {
+    uint64_t compiled = 0, evicted = 0, direct = 0, deferred = 0;
+    size_t entries = 0, bytes = 0;
+};
+
+class DisplayList {
+public:
+    // A frame compiles shapes whose boxes add up to at most compileCanvases
+    // canvases (and at least one shape), so a fresh scene costs its first
+    // frames about that much scratch traffic on top of drawing it.
+    explicit DisplayList(size_t byteBudget = (size_t)64 << 20, double compileCanvases = 4)
+        : budget(byteBudget), compileCanvases(compileCanvases) {}
+
+    void Clear() {
+        for (auto& kind : slots) kind.clear();
+        lru.clear();
+        stats.entries = stats.bytes = 0;
+        clipKnown = false;
+    }
+
+    // The shape was edited in place; it is compiled afresh when next drawn.
+    void Invalidate(ShapeRef ref) {
+        if ((size_t)ref.index < slots[ref.kind].size()) Drop(ref);
+    }
+
+    // Compiles what the refs (in painting order) that touch area lack,
+    // for the canvas: the whole frame rectangle, area being the part about
+    // to be repainted. Compiles run on pool if given. Call before drawing
+    // refs from tiles, with no tile drawing.
+    void Prepare(const Scene& scene, const std::vector<ShapeRef>& refs, const PixelRect& area, const PixelRect& canvas,
+        WorkStealingPool* pool = nullptr) {
+        ClipWindow w = ActiveClipWindow(scene);
+        if (!clipKnown || scene.currentClippingMethod != clipMethod || w.xmin != clip.xmin || w.ymin != clip.ymin ||
+            w.xmax != clip.xmax || w.ymax != clip.ymax) {
+            for (size_t i = 0; i < slots[SHAPE_LINES].size(); i++) Drop(ShapeRef{ SHAPE_LINES, (int)i });
+            clip = w;
+            clipMethod = scene.currentClippingMethod;
+            clipKnown = true;
+        }
+
+        frame++;
+        size_t frameBytes = 0;
+        double compileArea = 0, maxArea = compileCanvases * Area(canvas);
+        misses.clear();
+        for (const ShapeRef& ref : refs) {
+            if (ref.kind == SHAPE_POINTS) continue;
+            PixelRect bounds = ShapeBounds(scene, ref);
+            if (!Intersects(bounds, area)) continue;
+            std::vector<Slot>& kind = slots[ref.kind];
+            if ((size_t)ref.index >= kind.size()) kind.resize(ref.index + 1);
+            Slot& s = kind[ref.index];
+            PixelRect box = Intersect(bounds, canvas);
+            if (s.entry) {
+                if (Contains(s.entry->captured, box)) {
+                    lru.splice(lru.begin(), lru, s.lru);
+                    s.frame = frame;
+                    frameBytes += s.entry->Bytes();
+                    continue;
+                }
+                Drop(ref); // compiled for a smaller canvas
+            }
+            if (!misses.empty() && compileArea + Area(box) > maxArea) {
+                stats.deferred++;
+                continue;
+            }
+            compileArea += Area(box);
+            misses.push_back(ref);
+        }
+
+        // a few entries per thread at a time, so compiling stops soon after
+        // the budget is reached
+        size_t chunk = pool ? (size_t)pool->Threads() * 4 : 1;
+        for (size_t done = 0; done < misses.size(); done += chunk) {
+            size_t n = std::min(chunk, misses.size() - done);
+            pending.resize(n);
+            for (size_t j = 0; j < n; j++)
+                if (!pending[j]) pending[j].reset(new DisplayEntry());
+            auto compile = [&](int j) { CompileDisplayEntry(scene, w, misses[done + j], canvas, *pending[j]); };
+            if (pool) pool->Run((int)n, std::cref(compile));
+            else
+                for (size_t j = 0; j < n; j++) compile((int)j);
+
+            for (size_t j = 0; j < n; j++) {
+                size_t bytes = pending[j]->Bytes();
+                if (frameBytes + bytes > budget) {
+                    stats.direct += misses.size() - (done + j);
+                    return;
+                }
+                while (stats.bytes + bytes > budget) Evict();
+                ShapeRef ref = misses[done + j];
+                Slot& s = slots[ref.kind][ref.index];
+                s.entry = std::move(pending[j]);
+                lru.push_front(ref);
+                s.lru = lru.begin();
+                s.frame = frame;
+                frameBytes += bytes;
+                stats.bytes += bytes;
+                stats.entries++;
+                stats.compiled++;
+            }
+        }
+    }
+
+    // Null if ref is to be drawn directly.
+    const DisplayEntry* Find(ShapeRef ref) const {
+        const std::vector<Slot>& kind = slots[ref.kind];
+        return (size_t)ref.index < kind.size() ? kind[ref.index].entry.get() : nullptr;
+    }
+
+    DisplayListStats Stats() const { return stats; }
+
+private:
+    struct Slot {
+        std::unique_ptr<DisplayEntry> entry;
+        std::list<ShapeRef>::iterator lru;
+        uint64_t frame = 0;
+    };
+
+    static double Area(const PixelRect& r) {
+        return IsEmpty(r) ? 0 : (double)(r.right - r.left) * (r.bottom - r.top);
+    }
+
+    void Drop(ShapeRef ref) {
+        Slot& s = slots[ref.kind][ref.index];
+        if (!s.entry) return;
+        stats.bytes -= s.entry->Bytes();
+        stats.entries--;
+        s.entry.reset();
+        lru.erase(s.lru);
+    }
+
+    // Only entries from earlier frames: the current frame's fit the budget.
+    void Evict() {
+        Drop(lru.back());
+        stats.evicted++;
+    }
+
+    size_t budget;
+    double compileCanvases;
+    std::vector<Slot> slots[SHAPE_KIND_COUNT];
+    std::list<ShapeRef> lru; // most recently used first
+    uint64_t frame = 0;
+    ClipWindow clip = {};
+    ClippingMethod clipMethod = None;
+    bool clipKnown = false;
+    std::vector<ShapeRef> misses;
+    std::vector<std::unique_ptr<DisplayEntry>> pending;
+    DisplayListStats stats;
+};
+
+// DrawShapeList through the list: shapes with an entry are replayed, the
+// rest drawn. list must have been prepared for refs.
+inline void DrawDisplayList(RenderTarget& rt, const Scene& scene, const ClipWindow& w, const DisplayList& list,
+    const ShapeRef* refs, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (const DisplayEntry* e = list.Find(refs[i])) ReplayDisplayEntry(rt, *e);
+        else DrawShape(rt, scene, w, refs[i]);
+    }
+}
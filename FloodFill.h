@@ -0,0 +1,169 @@
+#pragma once
+
+// Span-based scanline flood fill on a RenderTarget.
+//
+// Boundary-fill semantics match FloodFillRecursive/FloodFillNonRecursive:
+// starting from the seed, every 4-connected pixel that is neither the
+// boundary color nor already the fill color is painted. Instead of one
+// stack entry per pixel, each entry is a horizontal run of the previous
+// row, and whole runs are filled with a single pass over memory.
+//
+// Trace finds the same region without writing the target: a bitmap marks
+// the pixels visited, and the region comes back as a list of runs that can
+// be painted again any number of times.
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "PixelBuffer.h"
+
+// Pixels [x1, x2] of row y.
+struct FloodRun {
+    int y, x1, x2;
+};
+
+class ScanlineFloodFill {
+public:
+    // maxPending bounds the span stack; a fill that would need more pending
+    // spans stops early and reports Overflowed().
+    explicit ScanlineFloodFill(size_t maxPending = 1 << 22) : maxPending(maxPending), overflowed(false) {
+        pending.reserve(1024);
+    }
+
+    // Returns the number of pixels painted. The span stack keeps its
+    // capacity between calls, so repeated fills do not allocate.
+    size_t Fill(RenderTarget& rt, int x, int y, COLORREF fillColor, COLORREF boundaryColor) {
+        runs = nullptr;
+        return Flood(rt, x, y, fillColor, boundaryColor);
+    }
+
+    // The runs Fill would paint, appended to out in the order painted; rt
+    // is only read. Returns their pixel count.
+    size_t Trace(const RenderTarget& rt, int x, int y, COLORREF fillColor, COLORREF boundaryColor,
+        std::vector<FloodRun>& out) {
+        runs = &out;
+        size_t first = out.size();
+        words = ((size_t)rt.width + 63) / 64;
+        if (visited.size() < words * rt.height) visited.resize(words * rt.height, 0);
+        size_t n = Flood(rt, x, y, fillColor, boundaryColor);
+        // the bitmap is left clear for the next trace
+        for (size_t i = first; i < out.size(); i++) {
+            const FloodRun& r = out[i];
+            uint64_t* row = visited.data() + (size_t)(r.y - rt.top) * words;
+            for (int px = r.x1 - rt.left; px <= r.x2 - rt.left; px++) row[px / 64] &= ~(1ull << (px % 64));
+        }
+        runs = nullptr;
+        return n;
+    }
+
+    bool Overflowed() const { return overflowed; }
+
+    // Smallest rectangle holding every pixel painted by the last Fill or
+    // Trace.
+    PixelRect FilledBounds() const { return bounds; }
+
+private:
+    struct Span {
+        int x1, x2, y, dy;
+    };
+
+    size_t Flood(const RenderTarget& rt, int x, int y, COLORREF fillColor, COLORREF boundaryColor) {
+        pending.clear();
+        overflowed = false;
+        filled = 0;
+        PixelRect none = { 0, 0, 0, 0 };
+        bounds = none;
+        target = &rt;
+        fill = ToPixel(fillColor);
+        boundary = ToPixel(boundaryColor);
+
+        if (!Inside(x, y)) return 0;
+
+        Push(x, x, y, 1);
+        Push(x, x, y - 1, -1);
+
+        while (!pending.empty()) {
+            Span s = pending.back();
+            pending.pop_back();
+            if (s.y < rt.clip.top || s.y >= rt.clip.bottom) continue;
+
+            uint32_t* row = PixelAt(rt, rt.left, s.y);
+            marks = runs ? visited.data() + (size_t)(s.y - rt.top) * words : nullptr;
+            int x1 = s.x1, x2 = s.x2;
+            int lx = x1;
+
+            // extend the run to the left of the parent span
+            if (InsideRow(row, lx)) {
+                while (InsideRow(row, lx - 1)) lx--;
+                if (lx < x1) {
+                    Paint(row, s.y, lx, x1 - 1);
+                    Push(lx, x1 - 1, s.y - s.dy, -s.dy);
+                }
+            }
+
+            while (x1 <= x2) {
+                int start = x1;
+                while (InsideRow(row, x1)) x1++;
+                if (x1 > start) Paint(row, s.y, start, x1 - 1);
+                if (x1 > lx) Push(lx, x1 - 1, s.y + s.dy, s.dy);
+                if (x1 - 1 > x2) Push(x2 + 1, x1 - 1, s.y - s.dy, -s.dy);
+                x1++;
+                while (x1 < x2 && !InsideRow(row, x1)) x1++;
+                lx = x1;
+            }
+        }
+        return filled;
+    }
+
+    bool Inside(int x, int y) {
+        if (y < target->clip.top || y >= target->clip.bottom) return false;
+        marks = runs ? visited.data() + (size_t)(y - target->top) * words : nullptr;
+        return InsideRow(PixelAt(*target, target->left, y), x);
+    }
+
+    // row and marks (the visited bitmap's row, when tracing) start at the
+    // target's left edge.
+    bool InsideRow(const uint32_t* row, int x) const {
+        if (x < target->clip.left || x >= target->clip.right) return false;
+        int i = x - target->left;
+        uint32_t p = row[i];
+        if (marks && (marks[i / 64] >> (i % 64) & 1)) return false;
+        return p != boundary && p != fill;
+    }
+
+    void Paint(uint32_t* row, int y, int x1, int x2) {
+        if (runs) {
+            for (int i = x1 - target->left; i <= x2 - target->left; i++) marks[i / 64] |= 1ull << (i % 64);
+            FloodRun r = { y, x1, x2 };
+            runs->push_back(r);
+        } else {
+            FillPixels(row + (x1 - target->left), (size_t)(x2 - x1 + 1), fill);
+        }
+        filled += (size_t)(x2 - x1 + 1);
+        PixelRect r = { x1, y, x2 + 1, y + 1 };
+        bounds = Union(bounds, r);
+    }
+
+    void Push(int x1, int x2, int y, int dy) {
+        if (y < target->clip.top || y >= target->clip.bottom) return;
+        if (pending.size() >= maxPending) {
+            overflowed = true;
+            return;
+        }
+        Span s = { x1, x2, y, dy };
+        pending.push_back(s);
+    }
+
+    std::vector<Span> pending;
+    size_t maxPending;
+    bool overflowed;
+    size_t filled = 0;
+    PixelRect bounds = { 0, 0, 0, 0 };
+    const RenderTarget* target = nullptr;
+    uint32_t fill = 0, boundary = 0;
+    // tracing: the runs found, and one bit per pixel of the target
+    std::vector<FloodRun>* runs = nullptr;
+    std::vector<uint64_t> visited;
+    size_t words = 0;
+    uint64_t* marks = nullptr;
+};
@@ -0,0 +1,271 @@
+#pragma once
+
+// Scratch memory for the render path.
+//
+// Every thread that draws owns a FrameArena (ThreadFrameArena). Scratch
+// buffers are bumped off its current chunk and given back when they go out
+// of scope; as long as they are released in reverse order, which locals
+// are, nested helpers keep reusing the same bytes. Anything released out
+// of order stays in place until the arena is reset.
+//
+// The app calls ResetFrameArenas once per WM_PAINT, while no tile is being
+// drawn. If a frame spilled into more than one chunk, the reset merges them
+// into a single chunk as large as all of them together, so a frame of the
+// same size finds enough room and takes nothing from the heap. The counters
+// in FrameArenaStats show whether that holds.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+struct FrameArenaStats {
+    uint64_t heapAllocations = 0; // chunks taken from the heap, ever
+    size_t capacity = 0;          // bytes held in chunks
+    size_t used = 0;              // bytes handed out and not given back
+    size_t peak = 0;              // most bytes in use at once, ever
+};
+
+class FrameArena {
+public:
+    explicit FrameArena(size_t chunkSize = 64 << 10) : chunkSize(chunkSize) {}
+
+    ~FrameArena() {
+        for (Chunk& c : chunks) ::operator delete(c.data);
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* Allocate(size_t bytes) {
+        bytes = Align(bytes);
+        if (chunks.empty() || chunks[current].used + bytes > chunks[current].size) NextChunk(bytes);
+        Chunk& c = chunks[current];
+        void* p = c.data + c.used;
+        c.used += bytes;
+        stats.used += bytes;
+        stats.peak = std::max(stats.peak, stats.used);
+        return p;
+    }
+
+    template <class T>
+    T* Allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        return (T*)Allocate(count * sizeof(T));
+    }
+
+    // Gives back p if it is the most recent allocation still held;
+    // otherwise it stays until Reset.
+    void Release(void* p, size_t bytes) {
+        bytes = Align(bytes);
+        if (!IsTop(p, bytes)) return;
+        chunks[current].used -= bytes;
+        stats.used -= bytes;
+        while (current > 0 && chunks[current].used == 0) current--;
+    }
+
+    // Grows the most recent allocation in place if its chunk has room.
+    bool Extend(void* p, size_t bytes, size_t newBytes) {
+        bytes = Align(bytes);
+        newBytes = Align(newBytes);
+        if (!IsTop(p, bytes) || chunks[current].used - bytes + newBytes > chunks[current].size) return false;
+        chunks[current].used += newBytes - bytes;
+        stats.used += newBytes - bytes;
+        stats.peak = std::max(stats.peak, stats.used);
+        return true;
+    }
+
+    // Forgets every allocation. Must not run while any of them is in use.
+    void Reset() {
+        if (chunks.size() > 1) {
+            size_t total = 0;
+            for (Chunk& c : chunks) {
+                total += c.size;
+                ::operator delete(c.data);
+            }
+            chunks.clear();
+            AddChunk(total);
+        }
+        for (Chunk& c : chunks) c.used = 0;
+        current = 0;
+        stats.used = 0;
+    }
+
+    const FrameArenaStats& Stats() const { return stats; }
+
+private:
+    struct Chunk {
+        unsigned char* data;
+        size_t size, used;
+    };
+
+    static size_t Align(size_t bytes) {
+        const size_t a = alignof(std::max_align_t);
+        return (bytes + a - 1) & ~(a - 1);
+    }
+
+    bool IsTop(void* p, size_t bytes) const {
+        if (chunks.empty() || bytes == 0) return false;
+        const Chunk& c = chunks[current];
+        return c.used >= bytes && (unsigned char*)p == c.data + c.used - bytes;
+    }
+
+    // Chunks after current are always empty; the first one large enough is
+    // used, or a new one is added.
+    void NextChunk(size_t bytes) {
+        for (size_t i = chunks.empty() ? 0 : current + 1; i < chunks.size(); i++) {
+            if (chunks[i].size >= bytes) {
+                current = i;
+                return;
+            }
+        }
+        size_t last = chunks.empty() ? chunkSize / 2 : chunks.back().size;
+        AddChunk(std::max(bytes, last * 2));
+        current = chunks.size() - 1;
+    }
+
+    void AddChunk(size_t size) {
+        Chunk c = { (unsigned char*)::operator new(size), size, 0 };
+        chunks.push_back(c);
+        stats.heapAllocations++;
+        stats.capacity = 0;
+        for (const Chunk& k : chunks) stats.capacity += k.size;
+    }
+
+    size_t chunkSize;
+    std::vector<Chunk> chunks;
+    size_t current = 0;
+    FrameArenaStats stats;
+};
+
+
+// Every thread's arena, so one call can reset them all between frames.
+class FrameArenaRegistry {
+public:
+    void Add(FrameArena* arena) {
+        std::lock_guard<std::mutex> lock(m);
+        arenas.push_back(arena);
+    }
+
+    void Remove(FrameArena* arena) {
+        std::lock_guard<std::mutex> lock(m);
+        arenas.erase(std::remove(arenas.begin(), arenas.end(), arena), arenas.end());
+    }
+
+    void ResetAll() {
+        std::lock_guard<std::mutex> lock(m);
+        for (FrameArena* a : arenas) a->Reset();
+    }
+
+    // Counters summed over the threads; peak is the largest single one.
+    FrameArenaStats Totals() {
+        std::lock_guard<std::mutex> lock(m);
+        FrameArenaStats total;
+        for (FrameArena* a : arenas) {
+            const FrameArenaStats& s = a->Stats();
+            total.heapAllocations += s.heapAllocations;
+            total.capacity += s.capacity;
+            total.used += s.used;
+            total.peak = std::max(total.peak, s.peak);
+        }
+        return total;
+    }
+
+private:
+    std::mutex m;
+    std::vector<FrameArena*> arenas;
+};
+
+inline FrameArenaRegistry& FrameArenas() {
+    static FrameArenaRegistry registry;
+    return registry;
+}
+
+class ThreadArena : public FrameArena {
+public:
+    ThreadArena() { FrameArenas().Add(this); }
+    ~ThreadArena() { FrameArenas().Remove(this); }
+};
+
+inline FrameArena& ThreadFrameArena() {
+    static thread_local ThreadArena arena;
+    return arena;
+}
+
+// Between frames only: no thread may be drawing.
+inline void ResetFrameArenas() {
+    FrameArenas().ResetAll();
+}
+
+inline FrameArenaStats FrameArenaTotals() {
+    return FrameArenas().Totals();
+}
+
+
+// Growable array of trivially copyable T in a FrameArena. It keeps the
+// std::vector names it needs so templates can fill either. While it is the
+// arena's most recent allocation it grows in place, and it gives its memory
+// back when destroyed.
+template <class T>
+class ScratchVector {
+public:
+    explicit ScratchVector(FrameArena& arena = ThreadFrameArena(), size_t capacity = 64)
+        : arena(arena), items(arena.Allocate<T>(capacity)), count(0), cap(capacity) {
+        static_assert(std::is_trivially_copyable<T>::value, "ScratchVector moves items with memcpy");
+    }
+
+    ~ScratchVector() { arena.Release(items, cap * sizeof(T)); }
+
+    ScratchVector(const ScratchVector&) = delete;
+    ScratchVector& operator=(const ScratchVector&) = delete;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* data() { return items; }
+    const T* data() const { return items; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    T& back() { return items[count - 1]; }
+    const T& back() const { return items[count - 1]; }
+
+    void clear() { count = 0; }
+
+    void push_back(const T& v) {
+        if (count == cap) Reserve(std::max(cap * 2, (size_t)8));
+        items[count++] = v;
+    }
+
+    // New items are left uninitialized.
+    void resize(size_t n) {
+        if (n > cap) Reserve(std::max(n, cap * 2));
+        count = n;
+    }
+
+private:
+    // A block that cannot grow in place is handed back first when it is the
+    // latest allocation: the larger one then lands in the next chunk and the
+    // old bytes stay intact until copied.
+    void Reserve(size_t n) {
+        if (arena.Extend(items, cap * sizeof(T), n * sizeof(T))) {
+            cap = n;
+            return;
+        }
+        arena.Release(items, cap * sizeof(T));
+        T* bigger = arena.Allocate<T>(n);
+        std::memmove(bigger, items, count * sizeof(T));
+        items = bigger;
+        cap = n;
+    }
+
+    FrameArena& arena;
+    T* items;
+    size_t count, cap;
+};
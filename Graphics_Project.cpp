@@ -4,8 +4,10 @@
 #include <string>
 #include <cmath>
 #include <algorithm>
-#include <stack>
 #include <iostream>
+#include <climits>
+#include "PixelBuffer.h"
+#include "Raster.h"
 using namespace std;
 
 #define ID_FILE_EXIT 1
@@ -42,15 +44,7 @@ using namespace std;
 
 
 
-int Round(double m) {
-    return (int)(m + 0.5);
-}
-
 // Structures for shapes
-struct Point {
-    int x, y;
-};
-
 struct Line {
     int x1, y1, x2, y2;
     COLORREF color;
@@ -77,7 +71,6 @@ bool firstClick = true;
 
 enum ShapeType { NONE, LINE, CIRCLE, Rec ,Square };
 ShapeType currentShapeType = LINE;
-enum LineAlgorithm { DDA,BRESENHAM,PARAMETRIC };
 enum CircleAlgorithm { DIRECT, POLAR, ITERATIVE_POLAR, MIDPOINT, MODIFIED_MIDPOINT, FILL_LINES, FILL_CIRCLES };
 enum ClippingMethod { None = 0, RECTANGLE = 1, SQUARE = 2 };
 
@@ -87,338 +80,12 @@ int currentQuarter = 1; // Default quarter
 ClippingMethod currentClippingMethod = None;
 
 
-// Circle functions
-void Draw8Points(HDC hdc, int xc, int yc, int x, int y, COLORREF c) {
-    SetPixel(hdc, xc + x, yc + y, c);
-    SetPixel(hdc, xc - x, yc + y, c);
-    SetPixel(hdc, xc + x, yc - y, c);
-    SetPixel(hdc, xc - x, yc - y, c);
-    SetPixel(hdc, xc + y, yc + x, c);
-    SetPixel(hdc, xc - y, yc + x, c);
-    SetPixel(hdc, xc + y, yc - x, c);
-    SetPixel(hdc, xc - y, yc - x, c);
-}
-
-void DrawPointsQuarter(HDC hdc, int xc, int yc, int x, int y, COLORREF c, int quarter) {
-    switch (quarter) {
-    case 1: // Top-right
-        SetPixel(hdc, xc + x, yc - y, c);
-        SetPixel(hdc, xc + y, yc - x, c);
-        break;
-    case 2: // Top-left
-        SetPixel(hdc, xc - x, yc - y, c);
-        SetPixel(hdc, xc - y, yc - x, c);
-        break;
-    case 3: // Bottom-left
-        SetPixel(hdc, xc - x, yc + y, c);
-        SetPixel(hdc, xc - y, yc + x, c);
-        break;
-    case 4: // Bottom-right
-        SetPixel(hdc, xc + x, yc + y, c);
-        SetPixel(hdc, xc + y, yc + x, c);
-        break;
-    }
-}
-
-void CircleDirectQuarter(HDC hdc, int xc, int yc, int R, COLORREF c, int quarter) {
-    int x = 0;
-    int y = R;
-    while (x <= y) {
-        y = (int)round(sqrt(R * R - x * x));
-        DrawPointsQuarter(hdc, xc, yc, x, y, c, quarter);
-        x++;
-    }
-}
-
-void DDAHorizontalLine(HDC hdc, int x1, int x2, int y, COLORREF c) {
-    if (x1 > x2) std::swap(x1, x2);
-    for (int x = x1; x <= x2; x++)
-        SetPixel(hdc, x, y, c);
-}
-
-void FillCircleWithLines(HDC hdc, int xc, int yc, int R, int quarter, COLORREF c) {
-    for (int y = 0; y <= R; y++) {
-        int x = (int)round(sqrt(R * R - y * y));
-        switch (quarter) {
-        case 1: // Top-right
-            DDAHorizontalLine(hdc, xc, xc + x, yc - y, c);
-            break;
-        case 2: // Top-left
-            DDAHorizontalLine(hdc, xc - x, xc, yc - y, c);
-            break;
-        case 3: // Bottom-left
-            DDAHorizontalLine(hdc, xc - x, xc, yc + y, c);
-            break;
-        case 4: // Bottom-right
-            DDAHorizontalLine(hdc, xc, xc + x, yc + y, c);
-            break;
-        }
-    }
-}
-
-void FillCircleWithCircles(HDC hdc, int xc, int yc, int R, int quarter, COLORREF c) {
-    for (int r = 0; r <= R; r++) {
-        CircleDirectQuarter(hdc, xc, yc, r, c, quarter);
-    }
-}
-
-void CircleDirect(HDC hdc, int xc, int yc, int R, COLORREF c) {
-    int x = 0;
-    int y = R;
-    while (x <= y) {
-        y = (int)round(sqrt(R * R - x * x));
-        Draw8Points(hdc, xc, yc, x, y, c);
-        x++;
-    }
-}
-
-void CirclePolar(HDC hdc, int xc, int yc, int R, COLORREF c) {
-    int x, y;
-    double theta = 0, dtheta = 1.0 / R;
-    while (theta <= 3.14159 / 4) {
-        x = (int)round(R * cos(theta));
-        y = (int)round(R * sin(theta));
-        Draw8Points(hdc, xc, yc, x, y, c);
-        theta += dtheta;
-    }
-}
-
-void CircleIterativePolar(HDC hdc, int xc, int yc, int R, COLORREF c) {
-    double x = R, y = 0;
-    double dtheta = 1.0 / R;
-    double cos_d = cos(dtheta), sin_d = sin(dtheta);
-    while (x > y) {
-        Draw8Points(hdc, xc, yc, (int)round(x), (int)round(y), c);
-        double x1 = x * cos_d - y * sin_d;
-        y = x * sin_d + y * cos_d;
-        x = x1;
-    }
-}
+// Offscreen frame every primitive is rasterized into; blitted once per paint.
+PixelBuffer frameBuffer;
 
-void CircleMidpoint(HDC hdc, int xc, int yc, int R, COLORREF c) {
-    int x = 0, y = R;
-    int d = 1 - R;
-    Draw8Points(hdc, xc, yc, x, y, c);
-    while (x < y) {
-        if (d < 0)
-            d += 2 * x + 3;
-        else {
-            d += 2 * (x - y) + 5;
-            y--;
-        }
-        x++;
-        Draw8Points(hdc, xc, yc, x, y, c);
-    }
-}
-
-void CircleModifiedMidpoint(HDC hdc, int xc, int yc, int R, COLORREF c) {
-    int x = 0, y = R;
-    int d = 1 - R;
-    int d1 = 3, d2 = 5 - 2 * R;
-    Draw8Points(hdc, xc, yc, x, y, c);
-    while (x < y) {
-        x++;
-        if (d < 0) {
-            d += d1;
-            d1 += 2;
-            d2 += 2;
-        }
-        else {
-            y--;
-            d += d2;
-            d1 += 2;
-            d2 += 4;
-        }
-        Draw8Points(hdc, xc, yc, x, y, c);
-    }
-}
-
-
-void DrawLineDDA(HDC hdc, int x1, int y1, int x2, int y2, COLORREF c)
-{
-
-    int dx = x2 - x1;
-    int dy = y2 - y1;
-    double x = x1;
-    double	y = y1;
-
-    SetPixel(hdc, x, y, c);
-    if (abs(dx) >= abs(dy))
-    {
-        int xi = dx > 0 ? 1 : -1;
-        double m = (double)dy / dx * xi;
-        while (x != x2)
-        {
-            x += xi;
-            y += m;
-            SetPixel(hdc, x, round(y), c);
-        }
-    }
-
-    else {
-        int yi = dy > 0 ? 1 : -1;
-        double m = (double)dx / dy * yi;
-
-        while (y != y2) {
-            y += yi;
-            x += m;
-            SetPixel(hdc, round(x), y, c);
-        }
-    }
-}
-void DrawLineBres(HDC hdc, int x1, int y1, int x2, int y2, COLORREF c)
-{
-    if (x2 < x1) {
-        swap(x1, x2);
-        swap(y1, y2);
-    }
-
-    int dx = abs(x2 - x1);
-    int dy = abs(y2 - y1);
-
-    // if line is vertical
-    if (dx == 0) {
-        int y = y1;
-        if (y < y2) {
-            while (y <= y2) {
-                SetPixel(hdc, x1, y, c);
-                y += 1;
-            }
-        }
-        else {
-            while (y >= y2) {
-                SetPixel(hdc, x1, y, c);
-                y -= 1;
-            }
-        }
-        return;
-    }
-
-
-    int x = x1, y = y1;
-    int sy = (y2 >= y1) ? 1 : -1;
-
-    bool isSteep = dy > dx;
-
-    if (isSteep) swap(dx, dy);
-
-    int d = -2 * dy + dx;
-    int d1 = -2 * dy;
-    int d2 = 2 * (dx - dy);
-
-    SetPixel(hdc, x, y, c);
-
-    while (x < x2) {
-        if (d < 0) {
-            d += d2;
-            if (isSteep) x += 1;
-            else y += sy;
-        }
-        else {
-            d += d1;
-        }
-
-        if (isSteep) y += sy;
-        else x += 1;
-
-        SetPixel(hdc, x, y, c);
-    }
-}
-void ParametricLine(HDC hdc, int x1, int y1,int x2, int y2, COLORREF c1)
-{
-    int alpha1 = x2 - x1;
-    int alpha2 = y2 - y1;
-
-    double steps = 1.0 / max(abs(alpha1),
-        abs(alpha2));
-
-    SetPixel(hdc, x1, y1, c1);
-    for (double t = 0; t < 1; t += steps)
-    {
-
-        double x = (alpha1 * t) + x1;
-        double y = (alpha2 * t) + y1;
-
-        SetPixel(hdc, Round(x), Round(y), c1);
-    }
-    SetPixel(hdc, x2, y2, c1);
-}
 //-----------------------------------------------------------------
 POINT points[2];
  int pointCount = 0;
- int xmin, ymin, xmax, ymax;
-
-//-------------------------------------------------------------------
-//clip point
-void clippingPoint(HDC hdc, int x, int y, COLORREF c) {
-    if (x >= xmin && x <= xmax && y >= ymin && y <= ymax) {
-        SetPixel(hdc, x, y, c);
-    }
-
-}
-//-----------------------------------------------------------------
-union OutCode
-{
-    unsigned All : 4;
-    struct { unsigned left : 1, top : 1, right : 1, bottom : 1; };
-};
-
-OutCode GetOutCode(double x, double y)
-{
-    OutCode out;
-    out.All = 0;
-    if (x < xmin) out.left = 1;
-    else if (x > xmax) out.right = 1;
-
-    if (y < ymin) out.top = 1;
-    else if (y > ymax) out.bottom = 1;
-
-    return out;
-}
-
-
-Point VIntersect(Point p1, Point p2, double xedge)
-{
-    Point result;
-    result.x = xedge;
-    result.y = ((xedge - p1.x) * (p2.y - p1.y) / (p2.x - p1.x)) + p1.y;
-    return result;
-}
-Point HIntersect(Point p1, Point p2, double yedge)
-{
-    Point result;
-    result.y = yedge;
-    result.x = ((yedge - p1.y) * (p2.x - p1.x) / (p2.y - p1.y)) + p1.x;
-    return result;
-}
-
-bool ClipLine(Point& p1, Point& p2) {
-    OutCode out1 = GetOutCode(p1.x, p1.y);
-    OutCode out2 = GetOutCode(p2.x, p2.y);
-
-    while (true) {
-        if (out1.All == 0 && out2.All == 0) return true;
-
-        if ((out1.All & out2.All) != 0) return false;
-
-        if (out1.All) {
-            if (out1.left) p1 = VIntersect(p1, p2, xmin);
-            else if (out1.top) p1 = HIntersect(p1, p2, ymin);
-            else if (out1.right) p1 = VIntersect(p1, p2, xmax);
-            else if (out1.bottom) p1 = HIntersect(p1, p2, ymax);
-
-            out1 = GetOutCode(p1.x, p1.y);
-        }
-        else {
-            if (out2.left) p2 = VIntersect(p1, p2, xmin);
-            else if (out2.top) p2 = HIntersect(p1, p2, ymin);
-            else if (out2.right) p2 = VIntersect(p1, p2, xmax);
-            else if (out2.bottom) p2 = HIntersect(p1, p2, ymax);
-
-            out2 = GetOutCode(p2.x, p2.y);
-        }
-    }
-}
 
 RECT clippingRect = { 0,0,0,0 };
 bool clippingEnabled = false;
@@ -430,72 +97,75 @@ bool clippingRectDrawn = false;
 bool clippingSquareDrawn = false;
 
 
-void DrawClippingRectangle(HDC hdc) {
+void DrawClippingRectangle(RenderTarget& rt, const ClipWindow& w) {
     if (clippingRectDrawn) {
-        DrawLineBres(hdc, xmin, ymin, xmax, ymin, RGB(255, 0, 0));
-        DrawLineBres(hdc, xmax, ymin, xmax, ymax, RGB(255, 0, 0));
-        DrawLineBres(hdc, xmax, ymax, xmin, ymax, RGB(255, 0, 0));
-        DrawLineBres(hdc, xmin, ymax, xmin, ymin, RGB(255, 0, 0));
+        DrawLineBres(rt, w.xmin, w.ymin, w.xmax, w.ymin, RGB(255, 0, 0));
+        DrawLineBres(rt, w.xmax, w.ymin, w.xmax, w.ymax, RGB(255, 0, 0));
+        DrawLineBres(rt, w.xmax, w.ymax, w.xmin, w.ymax, RGB(255, 0, 0));
+        DrawLineBres(rt, w.xmin, w.ymax, w.xmin, w.ymin, RGB(255, 0, 0));
     }
 }
 
-void DrawClippingSquare(HDC hdc) {
+void DrawClippingSquare(RenderTarget& rt, const ClipWindow& w) {
     if (clippingSquareDrawn) {
-        DrawLineBres(hdc, xmin, ymin, xmax, ymin, RGB(255, 0, 0));
-        DrawLineBres(hdc, xmax, ymin, xmax, ymax, RGB(255, 0, 0));
-        DrawLineBres(hdc, xmax, ymax, xmin, ymax, RGB(255, 0, 0));
-        DrawLineBres(hdc, xmin, ymax, xmin, ymin, RGB(255, 0, 0));
+        DrawLineBres(rt, w.xmin, w.ymin, w.xmax, w.ymin, RGB(255, 0, 0));
+        DrawLineBres(rt, w.xmax, w.ymin, w.xmax, w.ymax, RGB(255, 0, 0));
+        DrawLineBres(rt, w.xmax, w.ymax, w.xmin, w.ymax, RGB(255, 0, 0));
+        DrawLineBres(rt, w.xmin, w.ymax, w.xmin, w.ymin, RGB(255, 0, 0));
     }
 }
 
 // AllShapes
-void DrawAllShapes(HDC hdc) {
+void DrawAllShapes(RenderTarget& rt) {
+    ClipWindow w;
 
     if (currentClippingMethod == RECTANGLE && clippingEnabled) {
-        xmin = clippingRect.left;
-        ymin = clippingRect.top;
-        xmax = clippingRect.right;
-        ymax = clippingRect.bottom;
-        DrawClippingRectangle(hdc);
+        w.xmin = clippingRect.left;
+        w.ymin = clippingRect.top;
+        w.xmax = clippingRect.right;
+        w.ymax = clippingRect.bottom;
+        DrawClippingRectangle(rt, w);
 
 
     }
     else if (currentClippingMethod == SQUARE && clippingEnabledSquare) {
-        xmin = clippingSquare.left;
-        ymin = clippingSquare.top;
-        xmax = clippingSquare.right;
-        ymax = clippingSquare.bottom;
-        DrawClippingSquare(hdc);
+        w.xmin = clippingSquare.left;
+        w.ymin = clippingSquare.top;
+        w.xmax = clippingSquare.right;
+        w.ymax = clippingSquare.bottom;
+        DrawClippingSquare(rt, w);
     
     }
 
     else {
-        xmin = ymin = INT_MIN;
-        xmax = ymax = INT_MAX;
+        w.xmin = w.ymin = INT_MIN;
+        w.xmax = w.ymax = INT_MAX;
     }
 
     for (int i = 0; i < pointsArray.size(); i++) {
         int x = pointsArray[i].x;
         int y = pointsArray[i].y;
-        clippingPoint(hdc, x, y, RGB(255, 0, 0)); 
+        if (!Intersects(PaddedBounds(x, y, x, y), rt.clip)) continue;
+        clippingPoint(rt, w, x, y, RGB(255, 0, 0)); 
     }
 
     // Draw lines
     for (auto& line : lines) {
+        if (!Intersects(LineBounds(line.x1, line.y1, line.x2, line.y2), rt.clip)) continue;
         if (currentClippingMethod != None) {
             Point p1{ line.x1, line.y1 };
             Point p2{ line.x2, line.y2 };
 
-            if (ClipLine(p1, p2)) {
+            if (ClipLine(w, p1, p2)) {
                 switch (line.algorithm) {
                 case DDA:
-                    DrawLineDDA(hdc, p1.x, p1.y, p2.x, p2.y, line.color);
+                    DrawLineDDA(rt, p1.x, p1.y, p2.x, p2.y, line.color);
                     break;
                 case BRESENHAM:
-                    DrawLineBres(hdc, p1.x, p1.y, p2.x, p2.y, line.color);
+                    DrawLineBres(rt, p1.x, p1.y, p2.x, p2.y, line.color);
                     break;
                 case PARAMETRIC:
-                    ParametricLine(hdc, p1.x, p1.y, p2.x, p2.y, line.color);
+                    ParametricLine(rt, p1.x, p1.y, p2.x, p2.y, line.color);
                     break;
                 }
             }
@@ -503,13 +173,13 @@ void DrawAllShapes(HDC hdc) {
         else {
             switch (line.algorithm) {
             case DDA:
-                DrawLineDDA(hdc, line.x1, line.y1, line.x2, line.y2, line.color);
+                DrawLineDDA(rt, line.x1, line.y1, line.x2, line.y2, line.color);
                 break;
             case BRESENHAM:
-                DrawLineBres(hdc, line.x1, line.y1, line.x2, line.y2, line.color);
+                DrawLineBres(rt, line.x1, line.y1, line.x2, line.y2, line.color);
                 break;
             case PARAMETRIC:
-                ParametricLine(hdc, line.x1, line.y1, line.x2, line.y2, line.color);
+                ParametricLine(rt, line.x1, line.y1, line.x2, line.y2, line.color);
                 break;
             }
         }
@@ -517,29 +187,30 @@ void DrawAllShapes(HDC hdc) {
     }
     // Draw circles
     for (auto& circle : circles) {
+        if (!Intersects(CircleBounds(circle.xc, circle.yc, circle.R), rt.clip)) continue;
         switch (circle.algorithm) {
         case DIRECT:
-            CircleDirect(hdc, circle.xc, circle.yc, circle.R, circle.color);
+            CircleDirect(rt, circle.xc, circle.yc, circle.R, circle.color);
             break;
         case POLAR:
-            CirclePolar(hdc, circle.xc, circle.yc, circle.R, circle.color);
+            CirclePolar(rt, circle.xc, circle.yc, circle.R, circle.color);
             break;
         case ITERATIVE_POLAR:
-            CircleIterativePolar(hdc, circle.xc, circle.yc, circle.R, circle.color);
+            CircleIterativePolar(rt, circle.xc, circle.yc, circle.R, circle.color);
             break;
         case MIDPOINT:
-            CircleMidpoint(hdc, circle.xc, circle.yc, circle.R, circle.color);
+            CircleMidpoint(rt, circle.xc, circle.yc, circle.R, circle.color);
             break;
         case MODIFIED_MIDPOINT:
-            CircleModifiedMidpoint(hdc, circle.xc, circle.yc, circle.R, circle.color);
+            CircleModifiedMidpoint(rt, circle.xc, circle.yc, circle.R, circle.color);
             break;
         case FILL_LINES:
-            FillCircleWithLines(hdc, circle.xc, circle.yc, circle.R, circle.quarter, circle.color);
-            CircleDirect(hdc, circle.xc, circle.yc, circle.R, circle.color); // Draw outline
+            FillCircleWithLines(rt, circle.xc, circle.yc, circle.R, circle.quarter, circle.color);
+            CircleDirect(rt, circle.xc, circle.yc, circle.R, circle.color); // Draw outline
             break;
         case FILL_CIRCLES:
-            FillCircleWithCircles(hdc, circle.xc, circle.yc, circle.R, circle.quarter, circle.color);
-            CircleDirect(hdc, circle.xc, circle.yc, circle.R, circle.color);
+            FillCircleWithCircles(rt, circle.xc, circle.yc, circle.R, circle.quarter, circle.color);
+            CircleDirect(rt, circle.xc, circle.yc, circle.R, circle.color);
             break;
         }
     }
@@ -656,6 +327,7 @@ void AddMenus(HWND hwnd) {
     HMENU hLineAlgorithms = CreateMenu();
     HMENU hCircleAlgorithms = CreateMenu();
     HMENU hQuarter = CreateMenu();
+    HMENU hClipping = CreateMenu();
 
     // File menu
     AppendMenu(hFile, MF_STRING, ID_BACKGROUND_WHITE, "Set Background White");
@@ -670,7 +342,7 @@ void AddMenus(HWND hwnd) {
     AppendMenu(hColor, MF_STRING, ID_COLOR_GREEN, "Green");
     AppendMenu(hColor, MF_STRING, ID_COLOR_BLUE, "Blue");
     //point
-    AppendMenu(hPoint, MF_STRING, ID_POINT, L"Point");
+    AppendMenu(hPoint, MF_STRING, ID_POINT, "Point");
     AppendMenu(hPoint, MF_SEPARATOR, 0, NULL);
 
     // Line algorithms
@@ -874,6 +546,7 @@ LRESULT CALLBACK WindowProcedure(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
         POINT endPoint = { LOWORD(lp), HIWORD(lp) };
         //endPoint.y = HIWORD(lp);
         HDC hdc = GetDC(hwnd);
+        PixelRect damage = { 0, 0, 0, 0 };
         if (currentShapeType == LINE) {
             Line l;
             l.x1 = tempPoint.x;
@@ -883,6 +556,7 @@ LRESULT CALLBACK WindowProcedure(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
             l.color = currentColor;
             l.algorithm = currentLineAlgorithm;
             lines.push_back(l);
+            damage = LineBounds(l.x1, l.y1, l.x2, l.y2);
         }
 
         else if (currentShapeType == CIRCLE) {
@@ -895,10 +569,13 @@ LRESULT CALLBACK WindowProcedure(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
             c.quarter = currentQuarter;
             c.algorithm = currentCircleAlgorithm;
             circles.push_back(c);
+            damage = CircleBounds(c.xc, c.yc, c.R);
         }
 
         ReleaseDC(hwnd, hdc);
-        InvalidateRect(hwnd, NULL, TRUE);
+        // only the new shape needs repainting
+        RECT rc = ToRECT(damage);
+        InvalidateRect(hwnd, &rc, FALSE);
         ReleaseCapture();
         break;
 
@@ -909,12 +586,24 @@ LRESULT CALLBACK WindowProcedure(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
     case WM_PAINT: {
         PAINTSTRUCT ps;
         HDC hdc = BeginPaint(hwnd, &ps);
-        FillRect(hdc, &ps.rcPaint, bgBrush);
-        DrawAllShapes(hdc);
+        // frameBuffer keeps the last frame; redraw the damaged area only
+        PixelRect area = ToPixelRect(ps.rcPaint);
+        RenderTarget rt = ClipTarget(frameBuffer.Target(), area);
+        FillPixelRect(rt, area, RGB(255, 255, 255));
+        DrawAllShapes(rt);
+        PresentPixelBuffer(hdc, frameBuffer, area);
         EndPaint(hwnd, &ps);
         break;
     }
 
+    case WM_SIZE:
+        frameBuffer.Resize(LOWORD(lp), HIWORD(lp));
+        InvalidateRect(hwnd, NULL, FALSE);
+        break;
+
+    case WM_ERASEBKGND:
+        return 1; // WM_PAINT covers the whole update region
+
     case WM_SETCURSOR: {
         SetCursor(LoadCursor(NULL, IDC_CROSS));
         return TRUE;
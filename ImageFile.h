@@ -0,0 +1,138 @@
+#pragma once
+
+// Writes a PixelBuffer as a binary PPM (P6) or a PNG.
+//
+// The PNG encoder has no dependencies: image rows go into stored
+// (uncompressed) deflate blocks, so files are about 3 bytes per pixel but
+// open in any viewer. Use PPM when the output feeds another tool anyway.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "PixelBuffer.h"
+
+inline bool WriteImageBytes(const char* path, const std::vector<uint8_t>& bytes, std::string* error) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) {
+        if (error) *error = std::string("cannot create ") + path;
+        return false;
+    }
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok && error) *error = std::string("error writing ") + path;
+    return ok;
+}
+
+inline void AppendRgbRow(std::vector<uint8_t>& out, const PixelBuffer& buf, int y) {
+    const uint32_t* row = buf.pixels.data() + (size_t)y * buf.width;
+    for (int x = 0; x < buf.width; x++) {
+        uint32_t p = row[x];
+        out.push_back((uint8_t)(p >> 16));
+        out.push_back((uint8_t)(p >> 8));
+        out.push_back((uint8_t)p);
+    }
+}
+
+inline bool WritePPM(const char* path, const PixelBuffer& buf, std::string* error = nullptr) {
+    std::vector<uint8_t> bytes;
+    std::string header = "P6\n" + std::to_string(buf.width) + " " + std::to_string(buf.height) + "\n255\n";
+    bytes.reserve(header.size() + (size_t)buf.width * buf.height * 3);
+    bytes.insert(bytes.end(), header.begin(), header.end());
+    for (int y = 0; y < buf.height; y++) AppendRgbRow(bytes, buf, y);
+    return WriteImageBytes(path, bytes, error);
+}
+
+
+struct PngCrcTable {
+    uint32_t entries[256];
+    PngCrcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+inline uint32_t PngCrc(const uint8_t* data, size_t n, uint32_t crc = 0) {
+    static const PngCrcTable table; // thread-safe initialization
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// 5552 bytes is the most that can be summed before the 32-bit sums
+// could overflow, as in zlib.
+inline uint32_t Adler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1, b = 0;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t end = std::min(data.size(), pos + 5552);
+        for (; pos < end; pos++) {
+            a += data[pos];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+inline void AppendBigEndian(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+inline void AppendPngChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    AppendBigEndian(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    AppendBigEndian(out, PngCrc(out.data() + start, out.size() - start));
+}
+
+inline bool WritePNG(const char* path, const PixelBuffer& buf, std::string* error = nullptr) {
+    // filter byte 0 + RGB for every row
+    std::vector<uint8_t> raw;
+    raw.reserve((size_t)buf.height * (1 + (size_t)buf.width * 3));
+    for (int y = 0; y < buf.height; y++) {
+        raw.push_back(0);
+        AppendRgbRow(raw, buf, y);
+    }
+
+    // zlib stream of stored blocks
+    std::vector<uint8_t> z;
+    z.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    z.push_back(0x78);
+    z.push_back(0x01);
+    size_t pos = 0;
+    do {
+        size_t n = std::min(raw.size() - pos, (size_t)65535);
+        bool last = pos + n == raw.size();
+        z.push_back(last ? 1 : 0);
+        z.push_back((uint8_t)n);
+        z.push_back((uint8_t)(n >> 8));
+        z.push_back((uint8_t)~n);
+        z.push_back((uint8_t)(~n >> 8));
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+        pos += n;
+    } while (pos < raw.size());
+    AppendBigEndian(z, Adler32(raw));
+
+    std::vector<uint8_t> ihdr;
+    AppendBigEndian(ihdr, (uint32_t)buf.width);
+    AppendBigEndian(ihdr, (uint32_t)buf.height);
+    const uint8_t format[5] = { 8, 2, 0, 0, 0 }; // 8-bit RGB, no interlace
+    ihdr.insert(ihdr.end(), format, format + 5);
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<uint8_t> png(signature, signature + 8);
+    AppendPngChunk(png, "IHDR", ihdr);
+    AppendPngChunk(png, "IDAT", z);
+    AppendPngChunk(png, "IEND", std::vector<uint8_t>());
+    return WriteImageBytes(path, png, error);
+}
@@ -0,0 +1,360 @@
+#pragma once
+
+// The window's picture kept as separate layers and composited on repaint.
+//
+// The background is a single colour. Above it are three offscreen layers
+// of the window's size: the flood fills, the committed geometry and an
+// overlay with the clip window's outline and the clipping test points.
+// Layer pixels nothing was drawn on hold TransparentPixel, and the frame is
+// the background with each layer laid over it in that order (OverPixels).
+//
+// Each layer keeps the rectangles that changed since the last Update.
+// Update redraws only those, from the scene, and composites the frame only
+// where some layer changed. A repaint of an area whose layers are all clean
+// just presents the frame, so uncovering the window draws nothing; changing
+// the background colour redoes the composite but no layer; moving the clip
+// window redraws the overlay and the boxes of the lines it now cuts
+// differently, not every other shape.
+//
+// Each layer also keeps the box everything drawn on it lies in, so the
+// composite skips the layers with nothing in a row.
+//
+// A flood fill is traced against the geometry layer alone (SceneFills.h),
+// and the runs it covers are kept; the fills layer is painted from those
+// runs in the order the fills were added. A fill is traced again only when
+// geometry changes inside its box or on the pixels just around it, where
+// its boundary lies.
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include "Scene.h"
+#include "SceneIndex.h"
+#include "TileRenderer.h"
+#include "SceneFills.h"
+
+// In painting order; the fills lie under the geometry, so the outline of a
+// fill and whatever is drawn over it later stay in sight.
+enum CanvasLayer { LAYER_BACKGROUND, LAYER_FILLS, LAYER_GEOMETRY, LAYER_OVERLAY, LAYER_COUNT };
+
+// Layer a stored shape is drawn on.
+inline CanvasLayer LayerOf(const Scene& scene, ShapeRef ref) {
+    if (ref.kind == SHAPE_POINTS) return LAYER_OVERLAY;
+    if (ref.kind == SHAPE_ADVANCED) {
+        if (IsFloodFill(scene.advanced.kind[ref.index])) return LAYER_FILLS;
+    }
+    return LAYER_GEOMETRY;
+}
+
+// traced counts fills traced afresh, replayed fills painted from their runs,
+// overflowed traces given up because the span stack ran out.
+struct FillStats {
+    uint64_t traced = 0, replayed = 0, overflowed = 0;
+};
+
+class LayeredCanvas {
+public:
+    // Past this many rectangles a layer's changes are merged into one box.
+    static const int MaxDirtyRects = 256;
+
+    // maxFillSpans bounds the span stack of a fill's trace (ScanlineFloodFill).
+    LayeredCanvas(TileRenderer& renderer, COLORREF background, size_t maxFillSpans = 1 << 22)
+        : renderer(renderer), background(background), tracer(maxFillSpans) {
+        Resize(0, 0);
+    }
+
+    // Every layer starts out empty and the whole frame is composited again.
+    void Resize(int w, int h) {
+        width = std::max(w, 0);
+        height = std::max(h, 0);
+        fills.clear();
+        for (int l = LAYER_FILLS; l < LAYER_COUNT; l++) {
+            layers[l].Resize(width, height);
+            std::fill(layers[l].pixels.begin(), layers[l].pixels.end(), TransparentPixel);
+            used[l] = PixelRect{ 0, 0, 0, 0 };
+        }
+        for (int l = 0; l < LAYER_COUNT; l++) InvalidateAll((CanvasLayer)l);
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    COLORREF Background() const { return background; }
+
+    // The layers stay as they are; only the composite is redone.
+    void SetBackground(COLORREF c) {
+        if (c == background) return;
+        background = c;
+        InvalidateAll(LAYER_BACKGROUND);
+    }
+
+    // r of layer is redrawn from the scene by the next Update. For the
+    // background layer only the composite is redone.
+    void Invalidate(CanvasLayer layer, const PixelRect& r) {
+        PixelRect a = Intersect(r, Full());
+        if (IsEmpty(a)) return;
+        AddRect(dirty[layer], dirtyCount[layer], a);
+    }
+
+    void InvalidateAll(CanvasLayer layer) {
+        dirtyCount[layer] = 0;
+        AddRect(dirty[layer], dirtyCount[layer], Full());
+    }
+
+    // The clip window, or whether it is drawn, changed: the outline and the
+    // points move, and so do the lines it cuts. Nothing else depends on it.
+    // Only the lines whose clipped part differs from the one the geometry
+    // layer holds are redrawn, each over its own box, so fills away from
+    // them are not traced again.
+    void ClipWindowChanged(const Scene& scene) {
+        ClipWindow w = ActiveClipWindow(scene);
+        // the outline and the points it shows lie in the old window or the
+        // new one; without a window every point may appear or vanish
+        if (w.xmin == INT_MIN || drawnClip.xmin == INT_MIN) InvalidateAll(LAYER_OVERLAY);
+        else Invalidate(LAYER_OVERLAY, Union(ClipWindowBounds(drawnClip), ClipWindowBounds(w)));
+        const LineArrays& e = scene.lines.ends;
+        for (int i = 0; i < scene.lines.Size(); i++) {
+            Point a1(0, 0), a2(0, 0), b1(0, 0), b2(0, 0);
+            bool was = ClippedLine(e, i, drawnMethod, drawnClip, a1, a2);
+            bool now = ClippedLine(e, i, scene.currentClippingMethod, w, b1, b2);
+            if (was == now && (!now || (a1.x == b1.x && a1.y == b1.y && a2.x == b2.x && a2.y == b2.y))) continue;
+            PixelRect r = { 0, 0, 0, 0 };
+            if (was) r = LineBounds(a1.x, a1.y, a2.x, a2.y);
+            if (now) r = Union(r, LineBounds(b1.x, b1.y, b2.x, b2.y));
+            Invalidate(LAYER_GEOMETRY, r);
+        }
+    }
+
+    // After a load or a clear: everything is drawn again, and every fill
+    // traced again.
+    void SceneChanged() {
+        fills.clear();
+        for (int l = 0; l < LAYER_COUNT; l++) InvalidateAll((CanvasLayer)l);
+    }
+
+    // Redraws the changed parts of each layer and composites them into
+    // frame, which must be Width() x Height(). Fills added to the scene
+    // since the last Update are traced and painted. Returns the box of the
+    // frame that was composited, empty if nothing changed.
+    PixelRect Update(const Scene& scene, const SceneIndex& index, DisplayList* displayList, PixelBuffer& frame) {
+        ClipWindow w = ActiveClipWindow(scene);
+        int count = 0;
+        PixelRect composite[MaxDirtyRects];
+        // the fills are traced on the geometry, so it goes first
+        // Boxes that overlap a lot would draw the same shapes several times;
+        // past the area of their union, that is drawn once instead. The
+        // fills are still checked against each box.
+        PixelRect geometry = { 0, 0, 0, 0 };
+        double area = 0;
+        for (int i = 0; i < dirtyCount[LAYER_GEOMETRY]; i++) {
+            geometry = Union(geometry, dirty[LAYER_GEOMETRY][i]);
+            area += Area(dirty[LAYER_GEOMETRY][i]);
+        }
+        if (dirtyCount[LAYER_GEOMETRY] > 1 && area >= Area(geometry)) {
+            DrawGeometry(scene, index, displayList, geometry);
+            AddRect(composite, count, geometry);
+        } else {
+            for (int i = 0; i < dirtyCount[LAYER_GEOMETRY]; i++) {
+                DrawGeometry(scene, index, displayList, dirty[LAYER_GEOMETRY][i]);
+                AddRect(composite, count, dirty[LAYER_GEOMETRY][i]);
+            }
+        }
+        UpdateFills(scene);
+        dirtyCount[LAYER_GEOMETRY] = 0;
+        drawnMethod = scene.currentClippingMethod;
+        drawnClip = w;
+        for (int l = 0; l < LAYER_COUNT; l++) {
+            if (l == LAYER_GEOMETRY) continue;
+            for (int i = 0; i < dirtyCount[l]; i++) {
+                const PixelRect& r = dirty[l][i];
+                if (l == LAYER_FILLS) PaintFills(r);
+                else if (l == LAYER_OVERLAY) DrawOverlay(scene, w, r);
+                AddRect(composite, count, r);
+            }
+            dirtyCount[l] = 0;
+        }
+
+        PixelRect changed = { 0, 0, 0, 0 };
+        for (int i = 0; i < count; i++) {
+            Composite(frame, composite[i]);
+            changed = Union(changed, composite[i]);
+        }
+        return changed;
+    }
+
+    FillStats Stats() const { return stats; }
+
+    // Colour the geometry layer held at (x, y) after the last Update, which
+    // is what a fill seeded there is traced on; CLR_INVALID where nothing
+    // was drawn or outside the canvas.
+    COLORREF GeometryPixel(int x, int y) const {
+        if ((unsigned)x >= (unsigned)width || (unsigned)y >= (unsigned)height) return CLR_INVALID;
+        uint32_t p = layers[LAYER_GEOMETRY].pixels[(size_t)y * width + x];
+        return p == TransparentPixel ? CLR_INVALID : ToColorRef(p);
+    }
+
+private:
+    // The runs of an advanced shape that is a flood fill, valid once traced.
+    // A trace that overflowed keeps no runs and is tried again only once
+    // the geometry changes somewhere, as nothing tells how far it reaches.
+    struct FillEntry {
+        bool valid = false, overflowed = false;
+        PixelRect bounds = { 0, 0, 0, 0 };
+        uint32_t pixel = 0;
+        std::vector<FloodRun> runs;
+    };
+
+    // The part of line i DrawShape draws under the clipping method and
+    // window given; false if none.
+    static bool ClippedLine(const LineArrays& e, int i, ClippingMethod method, const ClipWindow& w, Point& p1,
+        Point& p2) {
+        p1 = Point(e.x1[i], e.y1[i]);
+        p2 = Point(e.x2[i], e.y2[i]);
+        return method == None || ClipLine(w, p1, p2);
+    }
+
+    static double Area(const PixelRect& r) {
+        return IsEmpty(r) ? 0 : (double)(r.right - r.left) * (r.bottom - r.top);
+    }
+
+    PixelRect Full() const {
+        PixelRect r = { 0, 0, width, height };
+        return r;
+    }
+
+    // Keeps rects at most MaxDirtyRects long; a rectangle inside one already
+    // there adds nothing.
+    static void AddRect(PixelRect* rects, int& count, const PixelRect& r) {
+        for (int i = 0; i < count; i++)
+            if (Contains(rects[i], r)) return;
+        if (count < MaxDirtyRects) {
+            rects[count++] = r;
+            return;
+        }
+        PixelRect all = r;
+        for (int i = 0; i < count; i++) all = Union(all, rects[i]);
+        rects[0] = all;
+        count = 1;
+    }
+
+    void ClearLayer(CanvasLayer layer, const PixelRect& r) {
+        if (!Intersects(r, used[layer])) return;
+        PixelBuffer& b = layers[layer];
+        for (int y = r.top; y < r.bottom; y++)
+            FillPixels(b.pixels.data() + (size_t)y * width + r.left, (size_t)(r.right - r.left), TransparentPixel);
+        if (Contains(r, used[layer])) used[layer] = PixelRect{ 0, 0, 0, 0 };
+    }
+
+    // Every shape but the points, cleared and drawn by the tile renderer.
+    void DrawGeometry(const Scene& scene, const SceneIndex& index, DisplayList* displayList, const PixelRect& r) {
+        if (Contains(r, Full())) {
+            // the index has nothing to rule out, and sorting what it finds
+            // costs more than drawing a few thousand shapes from the list
+            shapes.clear();
+            for (int k = 0; k < SHAPE_KIND_COUNT; k++) {
+                if (k == SHAPE_POINTS) continue;
+                for (int i = 0; i < ShapeCount(scene, (ShapeKind)k); i++) shapes.push_back(ShapeRef{ (ShapeKind)k, i });
+            }
+        } else {
+            index.Query(r, shapes);
+            shapes.erase(std::remove_if(shapes.begin(), shapes.end(), [](const ShapeRef& s) {
+                return s.kind == SHAPE_POINTS;
+            }), shapes.end());
+        }
+        RenderTarget rt = ClipTarget(layers[LAYER_GEOMETRY].Target(), r);
+        renderer.RenderLayer(rt, scene, shapes, displayList);
+        for (const ShapeRef& s : shapes)
+            used[LAYER_GEOMETRY] = Union(used[LAYER_GEOMETRY], Intersect(ShapeBounds(scene, s), r));
+    }
+
+    // Traces the fills that are new or whose surroundings the geometry dirty
+    // rects touch, and marks where they were and are on the fills layer.
+    void UpdateFills(const Scene& scene) {
+        const AdvancedTable& advanced = scene.advanced;
+        if (fills.size() < (size_t)advanced.Size()) fills.resize(advanced.Size());
+        RenderTarget geometry = layers[LAYER_GEOMETRY].Target();
+        for (int i = 0; i < advanced.Size(); i++) {
+            if (!IsActiveFloodFill(scene, i)) continue;
+            FillEntry& f = fills[i];
+            if (f.overflowed && dirtyCount[LAYER_GEOMETRY] == 0) continue;
+            if (f.valid) {
+                PixelRect around = { f.bounds.left - 1, f.bounds.top - 1, f.bounds.right + 1, f.bounds.bottom + 1 };
+                bool touched = false;
+                for (int d = 0; d < dirtyCount[LAYER_GEOMETRY] && !touched; d++)
+                    touched = Intersects(dirty[LAYER_GEOMETRY][d], around);
+                if (!touched) continue;
+                Invalidate(LAYER_FILLS, f.bounds);
+            }
+            f.valid = TraceSceneFill(tracer, geometry, scene, i, f.runs);
+            stats.traced++;
+            f.overflowed = tracer.Overflowed();
+            if (f.overflowed) {
+                stats.overflowed++;
+                continue;
+            }
+            f.bounds = tracer.FilledBounds();
+            f.pixel = ToPixel(advanced.color[i]);
+            Invalidate(LAYER_FILLS, f.bounds);
+        }
+    }
+
+    // Clears r of the fills layer and paints every fill over it again, in
+    // the order they were added.
+    void PaintFills(const PixelRect& r) {
+        ClearLayer(LAYER_FILLS, r);
+        RenderTarget rt = ClipTarget(layers[LAYER_FILLS].Target(), r);
+        for (const FillEntry& f : fills) {
+            if (!f.valid || !Intersects(f.bounds, r)) continue;
+            PaintFloodRuns(rt, f.runs, f.pixel);
+            used[LAYER_FILLS] = Union(used[LAYER_FILLS], Intersect(f.bounds, r));
+            stats.replayed++;
+        }
+    }
+
+    void DrawOverlay(const Scene& scene, const ClipWindow& w, const PixelRect& r) {
+        ClearLayer(LAYER_OVERLAY, r);
+        RenderTarget rt = ClipTarget(layers[LAYER_OVERLAY].Target(), r);
+        if ((scene.currentClippingMethod == RECTANGLE && scene.clippingEnabled && scene.clippingRectDrawn) ||
+            (scene.currentClippingMethod == SQUARE && scene.clippingEnabledSquare && scene.clippingSquareDrawn)) {
+            DrawClipOutline(rt, scene, w);
+            used[LAYER_OVERLAY] = Union(used[LAYER_OVERLAY], Intersect(ClipWindowBounds(w), r));
+        }
+        // points are single pixels: a pass over them beats an index query
+        const PointTable& p = scene.points;
+        for (int i = 0; i < p.Size(); i++) {
+            int x = p.x[i], y = p.y[i];
+            if (x < r.left || x >= r.right || y < r.top || y >= r.bottom) continue;
+            DrawShape(rt, scene, w, PointHandle{ i });
+            used[LAYER_OVERLAY] = Union(used[LAYER_OVERLAY], PixelRect{ x, y, x + 1, y + 1 });
+        }
+    }
+
+    void Composite(PixelBuffer& frame, const PixelRect& r) {
+        uint32_t bg = ToPixel(background);
+        size_t n = (size_t)(r.right - r.left);
+        for (int y = r.top; y < r.bottom; y++) {
+            size_t row = (size_t)y * width;
+            FillPixels(frame.pixels.data() + row + r.left, n, bg);
+            for (int l = LAYER_FILLS; l < LAYER_COUNT; l++) {
+                const PixelRect& u = used[l];
+                if (y < u.top || y >= u.bottom) continue;
+                int x1 = std::max(r.left, u.left), x2 = std::min(r.right, u.right);
+                if (x1 < x2) OverPixels(frame.pixels.data() + row + x1, layers[l].pixels.data() + row + x1, (size_t)(x2 - x1));
+            }
+        }
+    }
+
+    TileRenderer& renderer;
+    COLORREF background;
+    int width = 0, height = 0;
+    PixelBuffer layers[LAYER_COUNT]; // the background's stays empty
+    PixelRect used[LAYER_COUNT];
+    PixelRect dirty[LAYER_COUNT][MaxDirtyRects];
+    int dirtyCount[LAYER_COUNT] = {};
+    std::vector<ShapeRef> shapes;
+    // the clipping the geometry layer was last drawn with
+    ClippingMethod drawnMethod = None;
+    ClipWindow drawnClip = { INT_MIN, INT_MIN, INT_MAX, INT_MAX };
+    std::vector<FillEntry> fills; // by advanced shape index
+    ScanlineFloodFill tracer;
+    FillStats stats;
+};
@@ -0,0 +1,305 @@
+#pragma once
+
+// Integer rasterizers for the three selectable line algorithms.
+//
+// Each one walks the major axis a pixel at a time, and its own rounding
+// rule picks the minor coordinate. For pixel k = 0..D of a line with
+// major extent D, minor extent M and minor direction s:
+//
+//   minor(k) = minor0 + s * floor((bias + 2*M*k) / (2*D))
+//
+// DDA (std::round of the exact coordinate) rounds halves up on the canvas,
+// which is bias D when the minor coordinate grows and D - 1 when it
+// shrinks; the one tie that std::round sends the other way and is still
+// in sight, -0.5 going to -1 rather than 0, is left out by DrawLineAs. Bresenham's midpoint test breaks ties toward the row or column
+// it started on, bias D - 1, and always starts from the left end. The
+// parametric line rounds both coordinates at t = k/D with Round, whose
+// truncation toward zero moves every negative coordinate up by one:
+// wherever the DDA's pixel has a coordinate of -1, the parametric line's
+// lies on row or column 0 instead, unless the exact coordinate is -1.5.
+// It is walked as the DDA, and DrawParametricEdge adds those pixels.
+//
+// SetupLine intersects that walk with rt.clip in closed form: the first
+// and last k whose pixel is inside, and the error term at the first. The
+// walk itself is a loop specialised at compile time for the octant, which
+// writes through a pointer with no bounds tests. Horizontal lines go out
+// as spans. Extents must stay below 2^30, as the old int Bresenham
+// already required.
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include "PixelBuffer.h"
+
+enum LineAlgorithm { DDA, BRESENHAM, PARAMETRIC };
+
+inline long long LineFloorDiv(long long a, long long b) { // b > 0
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+inline long long LineCeilDiv(long long a, long long b) { // b > 0
+    return -LineFloorDiv(-a, b);
+}
+
+// A line after setup: count pixels starting at p. After each one the walk
+// moves one step along the major axis, adds inc to err, and also steps
+// along the minor axis once err reaches den.
+struct LineWalk {
+    uint32_t* p;
+    long long count, err, inc, den;
+    bool steep;
+    int majorStep, minorStep; // +1 or -1
+};
+
+// False if no pixel of the line lies inside rt.clip.
+inline bool SetupLine(const RenderTarget& rt, LineAlgorithm alg, int x1, int y1, int x2, int y2, LineWalk& w) {
+    if (alg == BRESENHAM && x2 < x1) {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+    }
+    long long dx = (long long)x2 - x1, dy = (long long)y2 - y1;
+    w.steep = std::abs(dy) > std::abs(dx);
+    long long majorDelta = w.steep ? dy : dx, minorDelta = w.steep ? dx : dy;
+    long long D = std::abs(majorDelta), M = std::abs(minorDelta);
+    w.majorStep = majorDelta < 0 ? -1 : 1;
+    w.minorStep = minorDelta < 0 ? -1 : 1;
+    long long scale = std::max(D, 1LL); // a single pixel when D is 0
+    long long bias = alg == BRESENHAM || w.minorStep < 0 ? scale - 1 : scale;
+    w.inc = 2 * M;
+    w.den = 2 * scale;
+
+    long long major0 = w.steep ? y1 : x1, minor0 = w.steep ? x1 : y1;
+    long long majorLo = w.steep ? rt.clip.top : rt.clip.left, majorHi = (w.steep ? rt.clip.bottom : rt.clip.right) - 1;
+    long long minorLo = w.steep ? rt.clip.left : rt.clip.top, minorHi = (w.steep ? rt.clip.right : rt.clip.bottom) - 1;
+
+    long long kBegin = 0, kEnd = D;
+    long long minorEnd = minor0 + w.minorStep * M;
+    if (major0 >= majorLo && major0 <= majorHi && major0 + w.majorStep * D >= majorLo && major0 + w.majorStep * D <= majorHi &&
+        minor0 >= minorLo && minor0 <= minorHi && minorEnd >= minorLo && minorEnd <= minorHi) {
+        // wholly inside: no divisions needed
+        w.p = PixelAt(rt, x1, y1);
+        w.err = bias;
+        w.count = D + 1;
+        return true;
+    }
+
+    // major0 + majorStep * k inside the clip
+    if (w.majorStep > 0) {
+        kBegin = std::max(kBegin, majorLo - major0);
+        kEnd = std::min(kEnd, majorHi - major0);
+    } else {
+        kBegin = std::max(kBegin, major0 - majorHi);
+        kEnd = std::min(kEnd, major0 - majorLo);
+    }
+
+    // the minor offset floor((bias + 2Mk) / 2D) inside [tLo, tHi]; it runs
+    // from 0 to M, which also keeps the products below in range
+    long long tLo = w.minorStep > 0 ? minorLo - minor0 : minor0 - minorHi;
+    long long tHi = w.minorStep > 0 ? minorHi - minor0 : minor0 - minorLo;
+    tLo = std::max(tLo, 0LL);
+    tHi = std::min(tHi, M);
+    if (tLo > tHi) return false;
+    if (M > 0) {
+        kBegin = std::max(kBegin, LineCeilDiv(w.den * tLo - bias, w.inc));
+        kEnd = std::min(kEnd, LineFloorDiv(w.den * (tHi + 1) - bias - 1, w.inc));
+    }
+    if (kBegin > kEnd) return false;
+
+    long long num = bias + w.inc * kBegin;
+    long long major = major0 + w.majorStep * kBegin, minor = minor0 + w.minorStep * (num / w.den);
+    long long x = w.steep ? minor : major, y = w.steep ? major : minor;
+    w.p = PixelAt(rt, (int)x, (int)y);
+    w.err = num % w.den;
+    w.count = kEnd - kBegin + 1;
+    return true;
+}
+
+template <bool Steep, int MajorStep, int MinorStep>
+inline void WalkLine(const LineWalk& w, ptrdiff_t stride, uint32_t pixel) {
+    const ptrdiff_t major = Steep ? MajorStep * stride : MajorStep;
+    const ptrdiff_t minor = Steep ? MinorStep : MinorStep * stride;
+    uint32_t* p = w.p;
+    long long err = w.err, inc = w.inc, den = w.den;
+    for (long long n = w.count;;) {
+        *p = pixel;
+        if (--n == 0) break;
+        p += major;
+        err += inc;
+        if (err >= den) {
+            err -= den;
+            p += minor;
+        }
+    }
+}
+
+// Writes len pixels from p along the major axis and returns the pointer
+// one step past the last.
+template <bool Steep, int MajorStep>
+inline uint32_t* WriteRun(uint32_t* p, long long len, ptrdiff_t stride, uint32_t pixel) {
+    if (!Steep) {
+        uint32_t* first = MajorStep > 0 ? p : p - (len - 1);
+        if (len >= 64) FillPixels(first, (size_t)len, pixel);
+        else
+            for (long long j = 0; j < len; j++) first[j] = pixel;
+        return p + MajorStep * len;
+    }
+    for (long long j = 0; j < len; j++, p += MajorStep * stride) *p = pixel;
+    return p;
+}
+
+// Lines at most a quarter as steep as a diagonal (or its mirror), walked a
+// run at a time: the pixels between two minor steps are written together.
+// Runs are q or q + 1 long, where q = den / inc; e, the error at the start
+// of the next run, picks which without a division.
+template <bool Steep, int MajorStep, int MinorStep>
+inline void SliceLine(const LineWalk& w, ptrdiff_t stride, uint32_t pixel) {
+    const ptrdiff_t minor = Steep ? MinorStep : MinorStep * stride;
+    if (w.inc == 0) {
+        WriteRun<Steep, MajorStep>(w.p, w.count, stride, pixel);
+        return;
+    }
+    long long inc = w.inc, q = w.den / inc, r = w.den % inc;
+    long long run = (w.den - w.err + inc - 1) / inc;
+    long long e = run * inc - (w.den - w.err);
+    uint32_t* p = w.p;
+    for (long long n = w.count;;) {
+        long long len = std::min(run, n);
+        p = WriteRun<Steep, MajorStep>(p, len, stride, pixel);
+        n -= len;
+        if (n == 0) break;
+        p += minor;
+        if (r > e) {
+            run = q + 1;
+            e += inc - r;
+        } else {
+            run = q;
+            e -= r;
+        }
+    }
+}
+
+// Runs of four or more are worth writing as runs; anything closer to the
+// diagonal steps pixel by pixel.
+template <bool Steep, int MajorStep, int MinorStep>
+inline void DrawOctant(const LineWalk& w, ptrdiff_t stride, uint32_t pixel) {
+    if (4 * w.inc > w.den) WalkLine<Steep, MajorStep, MinorStep>(w, stride, pixel);
+    else SliceLine<Steep, MajorStep, MinorStep>(w, stride, pixel);
+}
+
+inline void DrawLineWalk(RenderTarget& rt, const LineWalk& w, uint32_t pixel) {
+    ptrdiff_t stride = rt.width;
+    switch ((w.steep ? 4 : 0) | (w.majorStep > 0 ? 2 : 0) | (w.minorStep > 0 ? 1 : 0)) {
+    case 0: DrawOctant<false, -1, -1>(w, stride, pixel); break;
+    case 1: DrawOctant<false, -1, 1>(w, stride, pixel); break;
+    case 2: DrawOctant<false, 1, -1>(w, stride, pixel); break;
+    case 3: DrawOctant<false, 1, 1>(w, stride, pixel); break;
+    case 4: DrawOctant<true, -1, -1>(w, stride, pixel); break;
+    case 5: DrawOctant<true, -1, 1>(w, stride, pixel); break;
+    case 6: DrawOctant<true, 1, -1>(w, stride, pixel); break;
+    case 7: DrawOctant<true, 1, 1>(w, stride, pixel); break;
+    }
+}
+
+// k with lo < a + b * k < hi, narrowing [kLo, kHi].
+inline void LineOpenRange(long long a, long long b, long long lo, long long hi, long long& kLo, long long& kHi) {
+    if (b == 0) {
+        if (a <= lo || a >= hi) kHi = kLo - 1;
+        return;
+    }
+    if (b < 0) {
+        a = -a;
+        b = -b;
+        std::swap(lo, hi);
+        lo = -lo;
+        hi = -hi;
+    }
+    kLo = std::max(kLo, LineFloorDiv(lo - a, b) + 1);
+    kHi = std::min(kHi, LineCeilDiv(hi - a, b) - 1);
+}
+
+// The pixels the parametric line has on row or column 0 and the DDA walk
+// puts on -1: for k < D (Round's loop stops short of t = 1 and sets the
+// end point as it is), where x or y at t = k/D lies in (-1.5, -0.5).
+inline void DrawParametricEdge(RenderTarget& rt, int x1, int y1, int x2, int y2, uint32_t pixel) {
+    if (std::min(x1, x2) >= 0 && std::min(y1, y2) >= 0) return;
+    if (rt.clip.left > 0 && rt.clip.top > 0) return;
+    long long dx = (long long)x2 - x1, dy = (long long)y2 - y1;
+    long long D = std::max(std::max(std::abs(dx), std::abs(dy)), 1LL);
+    long long kMax = std::max(std::max(std::abs(dx), std::abs(dy)) - 1, 0LL);
+    // 2D times the coordinate at k is 2D*c + 2d*k; Round of it truncates
+    // (2D*c + 2d*k + D) / 2D toward zero, as C++ division does
+    for (int axis = 0; axis < 2; axis++) {
+        long long c = axis ? y1 : x1, d = axis ? dy : dx;
+        if ((axis ? rt.clip.top : rt.clip.left) > 0) continue;
+        long long kLo = 0, kHi = kMax;
+        LineOpenRange(2 * D * c, 2 * d, -3 * D, -D, kLo, kHi);
+        for (long long k = kLo; k <= kHi; k++) {
+            long long x = (2 * D * x1 + 2 * dx * k + D) / (2 * D), y = (2 * D * y1 + 2 * dy * k + D) / (2 * D);
+            if (x >= rt.clip.left && x < rt.clip.right && y >= rt.clip.top && y < rt.clip.bottom)
+                *PixelAt(rt, (int)x, (int)y) = pixel;
+        }
+    }
+}
+
+// The DDA's k with a minor coordinate of exactly -0.5, the pixel std::round
+// puts on -1 and the walk on 0: false if there is none, or it is out of
+// sight. Each k has a major coordinate of its own, returned in major.
+inline bool DdaNegativeTie(const RenderTarget& rt, int x1, int y1, int x2, int y2, long long& major) {
+    long long dx = (long long)x2 - x1, dy = (long long)y2 - y1;
+    bool steep = std::abs(dy) > std::abs(dx);
+    long long major0 = steep ? y1 : x1, minor0 = steep ? x1 : y1;
+    long long majorDelta = steep ? dy : dx, minorDelta = steep ? dx : dy;
+    long long D = std::abs(majorDelta);
+    if (minorDelta == 0 || std::min(minor0, minor0 + minorDelta) >= 0 || (steep ? rt.clip.left : rt.clip.top) > 0)
+        return false;
+    // 2D * minor0 + 2 * minorDelta * k = -D
+    long long num = -D - 2 * D * minor0, den = 2 * minorDelta;
+    if (num % den != 0) return false;
+    long long k = num / den;
+    if (k < 0 || k > D) return false;
+    major = major0 + (majorDelta < 0 ? -k : k);
+    return major >= (steep ? rt.clip.top : rt.clip.left) && major < (steep ? rt.clip.bottom : rt.clip.right);
+}
+
+// One line with its algorithm's rounding rule throughout; w is scratch.
+inline void DrawLineAs(RenderTarget& rt, LineAlgorithm alg, int x1, int y1, int x2, int y2, uint32_t pixel, LineWalk& w) {
+    long long tie;
+    if (alg == DDA && DdaNegativeTie(rt, x1, y1, x2, y2, tie)) {
+        // drawn either side of the tie's row or column
+        bool steep = std::abs((long long)y2 - y1) > std::abs((long long)x2 - x1);
+        RenderTarget before = rt, after = rt;
+        (steep ? before.clip.bottom : before.clip.right) = (int)tie;
+        (steep ? after.clip.top : after.clip.left) = (int)tie + 1;
+        if (!IsEmpty(before.clip) && SetupLine(before, alg, x1, y1, x2, y2, w)) DrawLineWalk(before, w, pixel);
+        if (!IsEmpty(after.clip) && SetupLine(after, alg, x1, y1, x2, y2, w)) DrawLineWalk(after, w, pixel);
+        return;
+    }
+    if (SetupLine(rt, alg, x1, y1, x2, y2, w)) DrawLineWalk(rt, w, pixel);
+    if (alg == PARAMETRIC) DrawParametricEdge(rt, x1, y1, x2, y2, pixel);
+}
+
+inline void DrawLine(RenderTarget& rt, LineAlgorithm alg, int x1, int y1, int x2, int y2, COLORREF c) {
+    LineWalk w;
+    DrawLineAs(rt, alg, x1, y1, x2, y2, ToPixel(c), w);
+}
+
+// Columns of many lines. Line i runs from (x1[i], y1[i]) to (x2[i], y2[i]);
+// its algorithm and colour are entry style[i] of those columns, or entry i
+// when style is null. Lines with an unknown algorithm are skipped.
+struct LineBatch {
+    const int *x1, *y1, *x2, *y2;
+    const int* algorithm;
+    const COLORREF* color;
+    const int* style;
+    size_t count;
+};
+
+inline void DrawLines(RenderTarget& rt, const LineBatch& b) {
+    LineWalk w;
+    for (size_t i = 0; i < b.count; i++) {
+        size_t s = b.style ? (size_t)b.style[i] : i;
+        int alg = b.algorithm[s];
+        if (alg < DDA || alg > PARAMETRIC) continue;
+        DrawLineAs(rt, (LineAlgorithm)alg, b.x1[i], b.y1[i], b.x2[i], b.y2[i], ToPixel(b.color[s]), w);
+    }
+}
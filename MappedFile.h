@@ -0,0 +1,92 @@
+#pragma once
+
+// Read-only memory mapping of a whole file (MapViewOfFile on Windows, mmap
+// elsewhere). The bytes stay valid until the object is destroyed.
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // An empty file opens successfully with Size() == 0.
+    bool Open(const char* path, std::string* error = nullptr) {
+        Close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return Fail(error, "cannot open ", path);
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) return Fail(error, "cannot stat ", path);
+        size = (size_t)fileSize.QuadPart;
+        if (size == 0) return true;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) return Fail(error, "cannot map ", path);
+        data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == NULL) return Fail(error, "cannot map ", path);
+#else
+        fd = open(path, O_RDONLY);
+        if (fd < 0) return Fail(error, "cannot open ", path);
+        struct stat st;
+        if (fstat(fd, &st) != 0) return Fail(error, "cannot stat ", path);
+        size = (size_t)st.st_size;
+        if (size == 0) return true;
+        void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) return Fail(error, "cannot map ", path);
+        data = (const unsigned char*)p;
+        madvise(p, size, MADV_SEQUENTIAL);
+#endif
+        return true;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap((void*)data, size);
+        if (fd >= 0) close(fd);
+        fd = -1;
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    const unsigned char* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    bool Fail(std::string* error, const char* what, const char* path) {
+        if (error) *error = std::string(what) + path;
+        Close();
+        return false;
+    }
+
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+};
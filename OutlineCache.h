@@ -0,0 +1,264 @@
+#pragma once
+
+// Circle and ellipse outlines computed once per size and replayed.
+//
+// An outline depends only on the algorithm and the radius (or a and b);
+// the centre just moves it. The first time a size is drawn, the points its
+// algorithm computes for one octant (circles) or quadrant (ellipses) are
+// folded into canonical form, sorted and deduplicated, and grouped by how
+// many distinct pixels their reflections give: a point on an axis or on
+// the diagonal maps onto itself under some reflections, and two computed
+// points can share a reflection. Replaying writes each distinct pixel of
+// the outline exactly once, through a pointer with no bounds tests when the
+// outline lies wholly inside the clip, and otherwise clipped pixel by pixel.
+// The set of pixels is exactly the one Draw8Points / Draw4Points leave.
+//
+// The cache is shared by every thread drawing tiles. Outlines are built
+// outside the lock and never change afterwards; once the points held pass
+// the budget the cache starts over, and an outline still being replayed by
+// another thread stays alive until it is done. Each thread also remembers
+// the last outline it used, so a run of shapes of one size takes no lock.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Raster.h"
+
+enum CircleAlgorithm { DIRECT, POLAR, ITERATIVE_POLAR, MIDPOINT, MODIFIED_MIDPOINT, FILL_LINES, FILL_CIRCLES };
+enum EllipseAlgorithm { DIRECTE, POLARE, MIDPOINTE };
+
+// Offsets from the centre. For circles every point has 0 <= x <= y and
+// stands for its eight reflections; for ellipses 0 <= x, 0 <= y and four.
+struct SymmetricOutline {
+    bool eightWay;
+    std::vector<Point> full;     // every reflection distinct: 8 or 4 pixels
+    std::vector<Point> axis;     // circles x == 0 < y: 4; ellipses x or y 0: 2
+    std::vector<Point> diagonal; // circles only, x == y > 0: 4
+    bool center;                 // the centre itself
+    int extentX, extentY;        // largest |x| and |y| of any pixel
+
+    size_t Points() const { return full.size() + axis.size() + diagonal.size() + (center ? 1 : 0); }
+};
+
+inline SymmetricOutline MakeSymmetricOutline(std::vector<Point>& points, bool eightWay) {
+    for (Point& p : points) {
+        p.x = std::abs(p.x);
+        p.y = std::abs(p.y);
+        if (eightWay && p.x > p.y) std::swap(p.x, p.y);
+    }
+    std::sort(points.begin(), points.end(), [](const Point& a, const Point& b) {
+        return a.y != b.y ? a.y > b.y : a.x < b.x;
+    });
+    points.erase(std::unique(points.begin(), points.end(), [](const Point& a, const Point& b) {
+        return a.x == b.x && a.y == b.y;
+    }), points.end());
+
+    SymmetricOutline o;
+    o.eightWay = eightWay;
+    o.center = false;
+    o.extentX = o.extentY = 0;
+    for (const Point& p : points) {
+        if (p.x == 0 && p.y == 0) o.center = true;
+        else if (p.x == 0 || (!eightWay && p.y == 0)) o.axis.push_back(p);
+        else if (eightWay && p.x == p.y) o.diagonal.push_back(p);
+        else o.full.push_back(p);
+        o.extentX = std::max(o.extentX, eightWay ? p.y : p.x);
+        o.extentY = std::max(o.extentY, p.y);
+    }
+    return o;
+}
+
+// Coordinates are copied out first: the pixel stores could alias them.
+template <class Put>
+inline void ReflectOutline(const SymmetricOutline& o, Put put) {
+    if (o.eightWay) {
+        for (const Point& p : o.full) {
+            int x = p.x, y = p.y;
+            put(x, y); put(-x, y); put(x, -y); put(-x, -y);
+            put(y, x); put(-y, x); put(y, -x); put(-y, -x);
+        }
+        for (const Point& p : o.axis) {
+            int y = p.y;
+            put(0, y); put(0, -y); put(y, 0); put(-y, 0);
+        }
+        for (const Point& p : o.diagonal) {
+            int x = p.x;
+            put(x, x); put(-x, x); put(x, -x); put(-x, -x);
+        }
+    } else {
+        for (const Point& p : o.full) {
+            int x = p.x, y = p.y;
+            put(x, y); put(-x, y); put(x, -y); put(-x, -y);
+        }
+        // (0, y) or (x, 0): the other coordinate's sign changes nothing
+        for (const Point& p : o.axis) {
+            int x = p.x, y = p.y;
+            put(x, y); put(-x, -y);
+        }
+    }
+    if (o.center) put(0, 0);
+}
+
+inline void DrawSymmetricOutline(RenderTarget& rt, int xc, int yc, const SymmetricOutline& o, COLORREF c) {
+    uint32_t pixel = ToPixel(c);
+    const PixelRect& clip = rt.clip;
+    if ((long long)xc - o.extentX >= clip.left && (long long)xc + o.extentX < clip.right &&
+        (long long)yc - o.extentY >= clip.top && (long long)yc + o.extentY < clip.bottom) {
+        uint32_t* center = PixelAt(rt, xc, yc);
+        ptrdiff_t stride = rt.width;
+        ReflectOutline(o, [&](int x, int y) { center[(ptrdiff_t)y * stride + x] = pixel; });
+        return;
+    }
+    ReflectOutline(o, [&](int x, int y) {
+        long long px = (long long)xc + x, py = (long long)yc + y;
+        if (px >= clip.left && px < clip.right && py >= clip.top && py < clip.bottom)
+            *PixelAt(rt, (int)px, (int)py) = pixel;
+    });
+}
+
+
+struct OutlineKey {
+    int kind; // 0 circle, 1 ellipse
+    int algorithm, a, b;
+
+    bool operator==(const OutlineKey& o) const {
+        return kind == o.kind && algorithm == o.algorithm && a == o.a && b == o.b;
+    }
+};
+
+struct OutlineKeyHash {
+    size_t operator()(const OutlineKey& k) const {
+        uint64_t h = (uint32_t)k.a * 0x9E3779B97F4A7C15ull ^ (uint32_t)k.b * 0xC2B2AE3D27D4EB4Full ^
+            (uint32_t)(k.kind * 8 + k.algorithm) * 0x165667B19E3779F9ull;
+        return (size_t)(h ^ (h >> 32));
+    }
+};
+
+// hits and misses count lookups that reached the table, not repeats of a
+// thread's previous lookup.
+struct OutlineCacheStats {
+    uint64_t hits = 0, misses = 0, flushes = 0;
+    size_t outlines = 0, points = 0;
+};
+
+class OutlineCache {
+public:
+    typedef std::shared_ptr<const SymmetricOutline> Entry;
+
+    // Lookups return an outline that stays valid until the calling thread
+    // looks up another one.
+    explicit OutlineCache(size_t pointBudget = 1 << 21) : budget(pointBudget) {}
+
+    // Null for an unknown algorithm. The fills share DIRECT's outline.
+    const SymmetricOutline* Circle(int algorithm, int R) {
+        if (algorithm == FILL_LINES || algorithm == FILL_CIRCLES) algorithm = DIRECT;
+        OutlineKey key = { 0, algorithm, R, R };
+        return Find(key, [&](std::vector<Point>& pts) {
+            auto plot = [&](int x, int y) { pts.push_back(Point(x, y)); };
+            switch (algorithm) {
+            case DIRECT: CircleDirectOctant(R, plot); break;
+            case POLAR: CirclePolarOctant(R, plot); break;
+            case ITERATIVE_POLAR: CircleIterativePolarOctant(R, plot); break;
+            case MIDPOINT: CircleMidpointOctant(R, plot); break;
+            case MODIFIED_MIDPOINT: CircleModifiedMidpointOctant(R, plot); break;
+            default: return false;
+            }
+            return true;
+        }, true);
+    }
+
+    const SymmetricOutline* Ellipse(int algorithm, int a, int b) {
+        OutlineKey key = { 1, algorithm, a, b };
+        return Find(key, [&](std::vector<Point>& pts) {
+            auto plot = [&](int x, int y) { pts.push_back(Point(x, y)); };
+            switch (algorithm) {
+            case DIRECTE: EllipseDirectQuadrant(a, b, plot); break;
+            case POLARE: EllipsePolarQuadrant(a, b, plot); break;
+            case MIDPOINTE: MidpointEllipseQuadrant(a, b, plot); break;
+            default: return false;
+            }
+            return true;
+        }, false);
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(m);
+        entries.clear();
+        stats.outlines = stats.points = 0;
+    }
+
+    OutlineCacheStats Stats() {
+        std::lock_guard<std::mutex> lock(m);
+        return stats;
+    }
+
+private:
+    struct LastUsed {
+        const OutlineCache* cache;
+        OutlineKey key;
+        Entry entry;
+    };
+
+    template <class Generate>
+    const SymmetricOutline* Find(const OutlineKey& key, Generate generate, bool eightWay) {
+        static thread_local LastUsed last = { nullptr, OutlineKey(), Entry() };
+        if (last.cache == this && last.key == key) return last.entry.get();
+        last.entry = Lookup(key, generate, eightWay);
+        last.cache = last.entry ? this : nullptr;
+        last.key = key;
+        return last.entry.get();
+    }
+
+    template <class Generate>
+    Entry Lookup(const OutlineKey& key, Generate generate, bool eightWay) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                stats.hits++;
+                return it->second;
+            }
+            stats.misses++;
+        }
+        std::vector<Point> pts;
+        if (!generate(pts)) return Entry();
+        Entry e = std::make_shared<const SymmetricOutline>(MakeSymmetricOutline(pts, eightWay));
+
+        std::lock_guard<std::mutex> lock(m);
+        if (stats.points + e->Points() > budget && !entries.empty()) {
+            entries.clear();
+            stats.outlines = stats.points = 0;
+            stats.flushes++;
+        }
+        auto ins = entries.insert(std::make_pair(key, e));
+        if (ins.second) {
+            stats.outlines++;
+            stats.points += e->Points();
+        }
+        return ins.first->second;
+    }
+
+    std::mutex m;
+    std::unordered_map<OutlineKey, Entry, OutlineKeyHash> entries;
+    size_t budget;
+    OutlineCacheStats stats;
+};
+
+inline OutlineCache& SharedOutlineCache() {
+    static OutlineCache cache;
+    return cache;
+}
+
+// The outline CircleDirect and friends would draw for algorithm, from the
+// shared cache. The two fill algorithms get CircleDirect's outline.
+inline void DrawCircleOutline(RenderTarget& rt, int algorithm, int xc, int yc, int R, COLORREF c) {
+    if (const SymmetricOutline* o = SharedOutlineCache().Circle(algorithm, R)) DrawSymmetricOutline(rt, xc, yc, *o, c);
+}
+
+inline void DrawEllipseOutline(RenderTarget& rt, int algorithm, int xc, int yc, int a, int b, COLORREF c) {
+    if (const SymmetricOutline* o = SharedOutlineCache().Ellipse(algorithm, a, b)) DrawSymmetricOutline(rt, xc, yc, *o, c);
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+// In-memory render target shared by the Win32 app and the headless tools.
+// Every raster routine writes into a contiguous 32-bit buffer; the window
+// receives the finished frame with a single blit (PresentPixelBuffer).
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "SpanKernels.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+// Same layout as the Win32 COLORREF (0x00BBGGRR) so saved scenes and colors
+// behave identically on every platform.
+typedef uint32_t COLORREF;
+#define RGB(r, g, b) ((COLORREF)(((uint32_t)(uint8_t)(r)) | (((uint32_t)(uint8_t)(g)) << 8) | (((uint32_t)(uint8_t)(b)) << 16)))
+#define GetRValue(rgb) ((uint8_t)(rgb))
+#define GetGValue(rgb) ((uint8_t)(((uint32_t)(rgb)) >> 8))
+#define GetBValue(rgb) ((uint8_t)(((uint32_t)(rgb)) >> 16))
+#define CLR_INVALID 0xFFFFFFFF
+#endif
+
+
+// Pixels are stored as 0x00RRGGBB, the native layout of a 32-bit DIB.
+inline uint32_t ToPixel(COLORREF c) {
+    return ((c & 0xFF) << 16) | (c & 0xFF00) | ((c >> 16) & 0xFF);
+}
+
+inline COLORREF ToColorRef(uint32_t p) {
+    return ((p & 0xFF) << 16) | (p & 0xFF00) | ((p >> 16) & 0xFF);
+}
+
+
+// Pixel rectangle; right and bottom are exclusive, like a Win32 RECT.
+struct PixelRect {
+    int left, top, right, bottom;
+};
+
+inline bool IsEmpty(const PixelRect& r) {
+    return r.left >= r.right || r.top >= r.bottom;
+}
+
+inline bool Intersects(const PixelRect& a, const PixelRect& b) {
+    if (IsEmpty(a) || IsEmpty(b)) return false;
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+inline PixelRect Intersect(const PixelRect& a, const PixelRect& b) {
+    PixelRect r = { std::max(a.left, b.left), std::max(a.top, b.top),
+        std::min(a.right, b.right), std::min(a.bottom, b.bottom) };
+    return r;
+}
+
+// An empty inner is inside anything.
+inline bool Contains(const PixelRect& outer, const PixelRect& inner) {
+    return IsEmpty(inner) || (inner.left >= outer.left && inner.top >= outer.top &&
+        inner.right <= outer.right && inner.bottom <= outer.bottom);
+}
+
+inline PixelRect Union(const PixelRect& a, const PixelRect& b) {
+    if (IsEmpty(a)) return b;
+    if (IsEmpty(b)) return a;
+    PixelRect r = { std::min(a.left, b.left), std::min(a.top, b.top),
+        std::max(a.right, b.right), std::max(a.bottom, b.bottom) };
+    return r;
+}
+
+
+// Non-owning view the algorithms draw into. Rows are `width` pixels apart;
+// writes are limited to `clip`, which never extends past the buffer.
+// pixels[0] is canvas pixel (left, top), so a buffer can stand in for just
+// part of the canvas.
+struct RenderTarget {
+    uint32_t* pixels;
+    int width, height;
+    PixelRect clip;
+    int left = 0, top = 0;
+};
+
+// Address of canvas pixel (x, y); it must lie in the buffer.
+inline uint32_t* PixelAt(const RenderTarget& rt, int x, int y) {
+    return rt.pixels + (ptrdiff_t)(y - rt.top) * rt.width + (x - rt.left);
+}
+
+// Same pixels, with writes further limited to r.
+inline RenderTarget ClipTarget(const RenderTarget& rt, const PixelRect& r) {
+    RenderTarget out = rt;
+    out.clip = Intersect(rt.clip, r);
+    return out;
+}
+
+inline void SetPixel(RenderTarget& rt, int x, int y, COLORREF c) {
+    if (x < rt.clip.left || x >= rt.clip.right || y < rt.clip.top || y >= rt.clip.bottom) return;
+    *PixelAt(rt, x, y) = ToPixel(c);
+}
+
+inline COLORREF GetPixel(const RenderTarget& rt, int x, int y) {
+    if ((unsigned)(x - rt.left) >= (unsigned)rt.width || (unsigned)(y - rt.top) >= (unsigned)rt.height)
+        return CLR_INVALID;
+    return ToColorRef(*PixelAt(rt, x, y));
+}
+
+// Horizontal run [x1, x2] on row y, clipped to the target.
+inline void FillSpan(RenderTarget& rt, int x1, int x2, int y, COLORREF c) {
+    if (y < rt.clip.top || y >= rt.clip.bottom) return;
+    if (x1 > x2) std::swap(x1, x2);
+    if (x1 < rt.clip.left) x1 = rt.clip.left;
+    if (x2 >= rt.clip.right) x2 = rt.clip.right - 1;
+    if (x1 > x2) return;
+    FillPixels(PixelAt(rt, x1, y), (size_t)(x2 - x1 + 1), ToPixel(c));
+}
+
+inline void FillPixelRect(RenderTarget& rt, const PixelRect& r, COLORREF c) {
+    PixelRect a = Intersect(rt.clip, r);
+    for (int y = a.top; y < a.bottom; y++)
+        FillSpan(rt, a.left, a.right - 1, y, c);
+}
+
+
+// Owning, contiguous 32-bit frame.
+struct PixelBuffer {
+    int width = 0, height = 0;
+    std::vector<uint32_t> pixels;
+
+    PixelBuffer() {}
+    PixelBuffer(int w, int h) { Resize(w, h); }
+
+    void Resize(int w, int h) {
+        width = std::max(w, 0);
+        height = std::max(h, 0);
+        pixels.assign((size_t)width * height, 0);
+    }
+
+    void Clear(COLORREF c) {
+        FillPixels(pixels.data(), pixels.size(), ToPixel(c));
+    }
+
+    RenderTarget Target() {
+        RenderTarget rt = { pixels.data(), width, height, { 0, 0, width, height } };
+        return rt;
+    }
+};
+
+
+#ifdef _WIN32
+// Copies the rectangle [x, x + w) x [y, y + h) of the buffer to the same
+// place on the device. The DIB handed to GDI starts at row y and is exactly
+// h rows tall, so the top-down/bottom-up source origin question never arises.
+inline void PresentPixelBuffer(HDC hdc, const PixelBuffer& buf, int x, int y, int w, int h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    w = std::min(w, buf.width - x);
+    h = std::min(h, buf.height - y);
+    if (w <= 0 || h <= 0) return;
+
+    BITMAPINFO bmi = {};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = buf.width;
+    bmi.bmiHeader.biHeight = -h; // top-down
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    SetDIBitsToDevice(hdc, x, y, w, h, x, 0, 0, h,
+        buf.pixels.data() + (size_t)y * buf.width, &bmi, DIB_RGB_COLORS);
+}
+
+inline void PresentPixelBuffer(HDC hdc, const PixelBuffer& buf) {
+    PresentPixelBuffer(hdc, buf, 0, 0, buf.width, buf.height);
+}
+
+inline void PresentPixelBuffer(HDC hdc, const PixelBuffer& buf, const PixelRect& r) {
+    PresentPixelBuffer(hdc, buf, r.left, r.top, r.right - r.left, r.bottom - r.top);
+}
+
+inline PixelRect ToPixelRect(const RECT& r) {
+    PixelRect p = { (int)r.left, (int)r.top, (int)r.right, (int)r.bottom };
+    return p;
+}
+
+inline RECT ToRECT(const PixelRect& r) {
+    RECT p = { r.left, r.top, r.right, r.bottom };
+    return p;
+}
+#endif
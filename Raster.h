@@ -0,0 +1,1076 @@
+#pragma once
+
+// Rasterization algorithms. Everything here draws into a RenderTarget and
+// has no dependency on the windowing system.
+
+#include <vector>
+#include <stack>
+#include <cmath>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include "PixelBuffer.h"
+#include "FrameArena.h"
+#include "LineRaster.h"
+
+inline int Round(double m) {
+    return (int)(m + 0.5);
+}
+
+struct Point {
+    int x, y;
+    Point(int x = 0, int y = 0) : x(x), y(y) {}
+};
+
+struct Entry {
+    int xmin, xmax;
+};
+
+
+// Stand-in for MoveToEx/LineTo with a solid pen: like GDI the end point is
+// not drawn, so consecutive segments of a polyline never overlap. Wider pens
+// are thickened across the major axis.
+inline void DrawPenLine(RenderTarget& rt, int x1, int y1, int x2, int y2, COLORREF c, int width = 1) {
+    int dx = std::abs(x2 - x1), dy = std::abs(y2 - y1);
+    int sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1;
+    bool steep = dy > dx;
+    int lo = -(width - 1) / 2, hi = width / 2;
+    // axis-aligned runs, such as box outlines, go out as whole spans
+    if (dy == 0) {
+        if (dx != 0)
+            for (int k = lo; k <= hi; k++) FillSpan(rt, x1, x2 - sx, y1 + k, c);
+        return;
+    }
+    if (dx == 0) {
+        for (int y = y1; y != y2; y += sy) FillSpan(rt, x1 + lo, x1 + hi, y, c);
+        return;
+    }
+    int err = dx - dy;
+    int x = x1, y = y1;
+    while (x != x2 || y != y2) {
+        for (int k = lo; k <= hi; k++) {
+            if (steep) SetPixel(rt, x + k, y, c);
+            else SetPixel(rt, x, y + k, c);
+        }
+        int e2 = 2 * err;
+        if (e2 > -dy) { err -= dy; x += sx; }
+        if (e2 < dx) { err += dx; y += sy; }
+    }
+}
+
+
+// Circle functions
+inline void Draw8Points(RenderTarget& rt, int xc, int yc, int x, int y, COLORREF c) {
+    SetPixel(rt, xc + x, yc + y, c);
+    SetPixel(rt, xc - x, yc + y, c);
+    SetPixel(rt, xc + x, yc - y, c);
+    SetPixel(rt, xc - x, yc - y, c);
+    SetPixel(rt, xc + y, yc + x, c);
+    SetPixel(rt, xc - y, yc + x, c);
+    SetPixel(rt, xc + y, yc - x, c);
+    SetPixel(rt, xc - y, yc - x, c);
+}
+
+inline void DrawPointsQuarter(RenderTarget& rt, int xc, int yc, int x, int y, COLORREF c, int quarter) {
+    switch (quarter) {
+    case 1: // Top-right
+        SetPixel(rt, xc + x, yc - y, c);
+        SetPixel(rt, xc + y, yc - x, c);
+        break;
+    case 2: // Top-left
+        SetPixel(rt, xc - x, yc - y, c);
+        SetPixel(rt, xc - y, yc - x, c);
+        break;
+    case 3: // Bottom-left
+        SetPixel(rt, xc - x, yc + y, c);
+        SetPixel(rt, xc - y, yc + x, c);
+        break;
+    case 4: // Bottom-right
+        SetPixel(rt, xc + x, yc + y, c);
+        SetPixel(rt, xc + y, yc + x, c);
+        break;
+    }
+}
+
+inline void CircleDirectQuarter(RenderTarget& rt, int xc, int yc, int R, COLORREF c, int quarter) {
+    int x = 0;
+    int y = R;
+    while (x <= y) {
+        y = (int)std::round(std::sqrt(R * R - x * x));
+        DrawPointsQuarter(rt, xc, yc, x, y, c, quarter);
+        x++;
+    }
+}
+
+inline void DDAHorizontalLine(RenderTarget& rt, int x1, int x2, int y, COLORREF c) {
+    FillSpan(rt, x1, x2, y, c);
+}
+
+// Filled circle written as whole horizontal spans. quarter 1-4 fills the
+// same quadrant as DrawPointsQuarter; 0 fills the whole disc.
+// The half-width of row y is round(sqrt(R*R - y*y)), tracked with integer
+// midpoint steps: it is the largest x with x*(x-1) < R*R - y*y.
+inline void FillCircleSpans(RenderTarget& rt, int xc, int yc, int R, int quarter, COLORREF c) {
+    if (R < 0) return;
+    long long v = (long long)R * R;      // R*R - y*y
+    long long xx = (long long)R * (R - 1); // x*(x-1)
+    int x = R;
+    for (int y = 0; y <= R; y++) {
+        while (x > 0 && xx >= v) {
+            xx -= 2LL * (x - 1);
+            x--;
+        }
+        switch (quarter) {
+        case 0:
+            FillSpan(rt, xc - x, xc + x, yc - y, c);
+            if (y != 0) FillSpan(rt, xc - x, xc + x, yc + y, c);
+            break;
+        case 1: // Top-right
+            FillSpan(rt, xc, xc + x, yc - y, c);
+            break;
+        case 2: // Top-left
+            FillSpan(rt, xc - x, xc, yc - y, c);
+            break;
+        case 3: // Bottom-left
+            FillSpan(rt, xc - x, xc, yc + y, c);
+            break;
+        case 4: // Bottom-right
+            FillSpan(rt, xc, xc + x, yc + y, c);
+            break;
+        }
+        v -= 2LL * y + 1;
+    }
+}
+
+inline void FillCircleWithLines(RenderTarget& rt, int xc, int yc, int R, int quarter, COLORREF c) {
+    FillCircleSpans(rt, xc, yc, R, quarter, c);
+}
+
+// Used to stack CircleDirectQuarter outlines for every radius, which cost
+// O(R^2) square roots and left unfilled gaps between rings; the span fill
+// covers the same quadrant solidly.
+inline void FillCircleWithCircles(RenderTarget& rt, int xc, int yc, int R, int quarter, COLORREF c) {
+    FillCircleSpans(rt, xc, yc, R, quarter, c);
+}
+
+// Each circle algorithm in two parts: ...Octant calls plot(x, y) for the
+// points it computes in one octant, and the drawing function reflects each
+// of them eight ways with Draw8Points. OutlineCache.h records the same
+// points once per radius and replays them instead.
+template <class Plot>
+inline void CircleDirectOctant(int R, Plot plot) {
+    int x = 0;
+    int y = R;
+    while (x <= y) {
+        y = (int)std::round(std::sqrt(R * R - x * x));
+        plot(x, y);
+        x++;
+    }
+}
+
+template <class Plot>
+inline void CirclePolarOctant(int R, Plot plot) {
+    if (R < 0) return; // theta would never reach pi/4
+    int x, y;
+    double theta = 0, dtheta = 1.0 / R;
+    while (theta <= 3.14159 / 4) {
+        x = (int)std::round(R * std::cos(theta));
+        y = (int)std::round(R * std::sin(theta));
+        plot(x, y);
+        theta += dtheta;
+    }
+}
+
+template <class Plot>
+inline void CircleIterativePolarOctant(int R, Plot plot) {
+    double x = R, y = 0;
+    double dtheta = 1.0 / R;
+    double cos_d = std::cos(dtheta), sin_d = std::sin(dtheta);
+    while (x > y) {
+        plot((int)std::round(x), (int)std::round(y));
+        double x1 = x * cos_d - y * sin_d;
+        y = x * sin_d + y * cos_d;
+        x = x1;
+    }
+}
+
+template <class Plot>
+inline void CircleMidpointOctant(int R, Plot plot) {
+    int x = 0, y = R;
+    int d = 1 - R;
+    plot(x, y);
+    while (x < y) {
+        if (d < 0)
+            d += 2 * x + 3;
+        else {
+            d += 2 * (x - y) + 5;
+            y--;
+        }
+        x++;
+        plot(x, y);
+    }
+}
+
+template <class Plot>
+inline void CircleModifiedMidpointOctant(int R, Plot plot) {
+    int x = 0, y = R;
+    int d = 1 - R;
+    int d1 = 3, d2 = 5 - 2 * R;
+    plot(x, y);
+    while (x < y) {
+        x++;
+        if (d < 0) {
+            d += d1;
+            d1 += 2;
+            d2 += 2;
+        }
+        else {
+            y--;
+            d += d2;
+            d1 += 2;
+            d2 += 4;
+        }
+        plot(x, y);
+    }
+}
+
+inline void CircleDirect(RenderTarget& rt, int xc, int yc, int R, COLORREF c) {
+    CircleDirectOctant(R, [&](int x, int y) { Draw8Points(rt, xc, yc, x, y, c); });
+}
+
+inline void CirclePolar(RenderTarget& rt, int xc, int yc, int R, COLORREF c) {
+    CirclePolarOctant(R, [&](int x, int y) { Draw8Points(rt, xc, yc, x, y, c); });
+}
+
+inline void CircleIterativePolar(RenderTarget& rt, int xc, int yc, int R, COLORREF c) {
+    CircleIterativePolarOctant(R, [&](int x, int y) { Draw8Points(rt, xc, yc, x, y, c); });
+}
+
+inline void CircleMidpoint(RenderTarget& rt, int xc, int yc, int R, COLORREF c) {
+    CircleMidpointOctant(R, [&](int x, int y) { Draw8Points(rt, xc, yc, x, y, c); });
+}
+
+inline void CircleModifiedMidpoint(RenderTarget& rt, int xc, int yc, int R, COLORREF c) {
+    CircleModifiedMidpointOctant(R, [&](int x, int y) { Draw8Points(rt, xc, yc, x, y, c); });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//ELLIPSE
+
+inline void Draw4Points(RenderTarget& rt, int xc, int yc, int x, int y, COLORREF c) {
+    SetPixel(rt, xc + x, yc + y, c);
+    SetPixel(rt, xc - x, yc + y, c);
+    SetPixel(rt, xc + x, yc - y, c);
+    SetPixel(rt, xc - x, yc - y, c);
+}
+
+// As with circles, ...Quadrant calls plot(x, y) for the points each
+// algorithm computes and the drawing function reflects them four ways.
+// a is width and b is height; their signs do not matter.
+
+// Region 1 steps x up to the point where the outline is as steep as a
+// diagonal, x = a^2 / sqrt(a^2 + b^2), and region 2 steps y up to the
+// matching y = b^2 / sqrt(a^2 + b^2); each goes one pixel past it so the
+// two meet. Running both to the far end only doubled pixels up there.
+template <class Plot>
+inline void EllipseDirectQuadrant(int a, int b, Plot plot) {
+    double A = std::abs((double)a), B = std::abs((double)b);
+    if (A == 0 || B == 0) {
+        for (int x = 0; x <= (int)A; x++) plot(x, 0);
+        for (int y = 1; y <= (int)B; y++) plot(0, y);
+        return;
+    }
+    double diagonal = std::sqrt(A * A + B * B);
+    int xEnd = (int)std::min(A, std::ceil(A * A / diagonal)), yEnd = (int)std::min(B, std::ceil(B * B / diagonal));
+    for (int x = 0; x <= xEnd; x++) plot(x, (int)std::round(B * std::sqrt(1 - (x / A) * (x / A))));
+    for (int y = 0; y <= yEnd; y++) plot((int)std::round(A * std::sqrt(1 - (y / B) * (y / B))), y);
+}
+
+// One quadrant, angle 0 to pi/2 in steps of about a pixel; Draw4Points
+// mirrors it into the other three.
+template <class Plot>
+inline void EllipsePolarQuadrant(int a, int b, Plot plot) {
+    double A = std::abs((double)a), B = std::abs((double)b);
+    double quarter = 3.14159265358979 / 2, dtheta = 1.0 / std::max(std::max(A, B), 1.0);
+    for (double theta = 0; theta < quarter; theta += dtheta)
+        plot((int)std::round(A * std::cos(theta)), (int)std::round(B * std::sin(theta)));
+    plot(0, (int)B);
+}
+
+// Integer midpoint ellipse, first quadrant, one row at a time: run(y, x1,
+// x2) for each row y from b down to 0 with the outline's pixels x1..x2 on
+// it. Region 1, flatter than a diagonal, steps x and picks between rows at
+// the midpoint; region 2 steps y and picks between columns.
+//
+// The decision variable is 4 F at the midpoint, F(x, y) = b^2 x^2 + a^2 y^2
+// - a^2 b^2, kept exact in 64 bits. Region 2 starts from region 1's value
+// rather than from F itself, so nothing of order a^2 b^2 is ever formed and
+// the largest terms are about 16 a^2 b: axes up to 500000 pixels are safe.
+// A midpoint exactly on the outline counts as outside in region 1 and as
+// inside in region 2.
+template <class Run>
+inline void MidpointEllipseRuns(int a, int b, Run run) {
+    long long A = std::abs((long long)a), B = std::abs((long long)b);
+    if (B == 0) {
+        run(0, 0, (int)A);
+        return;
+    }
+    long long a2 = A * A, b2 = B * B;
+    long long x = 0, y = B, first = 0;
+    long long d = 4 * b2 - 4 * a2 * B + a2; // 4 F(1, b - 1/2)
+    long long dx = 0, dy = 2 * a2 * B;
+
+    // d >= 4 (dy - 2 a^2): the next column is two rows down, which only a
+    // very thin ellipse reaches before the tangent point; region 2 takes it
+    while (dx < dy && d < 4 * (dy - 2 * a2)) {
+        x++;
+        dx += 2 * b2;
+        if (d < 0) {
+            d += 4 * (dx + b2);
+        }
+        else {
+            run((int)y, (int)first, (int)(x - 1));
+            first = x;
+            y--;
+            dy -= 2 * a2;
+            d += 4 * (dx - dy + b2);
+        }
+    }
+    // row 0 always runs out to the tip, which a thin ellipse reaches
+    // several columns after its first pixel there
+    run((int)y, (int)first, (int)(y == 0 ? A : x));
+
+    d -= b2 * (4 * x + 3) + a2 * (4 * y - 3); // 4 F(x + 1/2, y - 1)
+    while (y > 0) {
+        y--;
+        dy -= 2 * a2;
+        if (d > 0) {
+            d += 4 * (a2 - dy);
+        }
+        else {
+            x++;
+            dx += 2 * b2;
+            d += 4 * (dx - dy + a2);
+        }
+        run((int)y, (int)x, (int)(y == 0 ? A : x));
+    }
+}
+
+template <class Plot>
+inline void MidpointEllipseQuadrant(int a, int b, Plot plot) {
+    MidpointEllipseRuns(a, b, [&](int y, int x1, int x2) {
+        for (int x = x1; x <= x2; x++) plot(x, y);
+    });
+}
+
+inline void ellipseDirect(RenderTarget& rt, int xc, int yc, int a, int b, COLORREF c) {
+    EllipseDirectQuadrant(a, b, [&](int x, int y) { Draw4Points(rt, xc, yc, x, y, c); });
+}
+
+inline void ellipsePolar(RenderTarget& rt, int xc, int yc, int a, int b, COLORREF c) {
+    EllipsePolarQuadrant(a, b, [&](int x, int y) { Draw4Points(rt, xc, yc, x, y, c); });
+}
+
+// Columns x1..x2 of row y of the first quadrant, reflected into quarter
+// 1-4 (numbered as in FillCircleSpans) or into all four when quarter is 0.
+inline void EllipseRowSpans(RenderTarget& rt, int xc, int yc, int y, int x1, int x2, int quarter, COLORREF c) {
+    switch (quarter) {
+    case 0:
+        if (x1 == 0) {
+            FillSpan(rt, xc - x2, xc + x2, yc - y, c);
+            if (y != 0) FillSpan(rt, xc - x2, xc + x2, yc + y, c);
+            break;
+        }
+        FillSpan(rt, xc + x1, xc + x2, yc - y, c);
+        FillSpan(rt, xc - x2, xc - x1, yc - y, c);
+        if (y != 0) {
+            FillSpan(rt, xc + x1, xc + x2, yc + y, c);
+            FillSpan(rt, xc - x2, xc - x1, yc + y, c);
+        }
+        break;
+    case 1: // Top-right
+        FillSpan(rt, xc + x1, xc + x2, yc - y, c);
+        break;
+    case 2: // Top-left
+        FillSpan(rt, xc - x2, xc - x1, yc - y, c);
+        break;
+    case 3: // Bottom-left
+        FillSpan(rt, xc - x2, xc - x1, yc + y, c);
+        break;
+    case 4: // Bottom-right
+        FillSpan(rt, xc + x1, xc + x2, yc + y, c);
+        break;
+    }
+}
+
+// The outline's rows go out as spans, so the flat top and bottom of a
+// wide ellipse are written as runs.
+inline void MidpointEllipse(RenderTarget& rt, int xc, int yc, int a, int b, COLORREF c) {
+    MidpointEllipseRuns(a, b, [&](int y, int x1, int x2) { EllipseRowSpans(rt, xc, yc, y, x1, x2, 0, c); });
+}
+
+inline void MidpointEllipseQuarter(RenderTarget& rt, int xc, int yc, int a, int b, int quarter, COLORREF c) {
+    MidpointEllipseRuns(a, b, [&](int y, int x1, int x2) { EllipseRowSpans(rt, xc, yc, y, x1, x2, quarter, c); });
+}
+
+// Filled ellipse, or one quarter of it: every row from the centre out to
+// the midpoint outline's outermost pixel, outline included.
+inline void FillEllipseSpans(RenderTarget& rt, int xc, int yc, int a, int b, int quarter, COLORREF c) {
+    MidpointEllipseRuns(a, b, [&](int y, int, int x2) { EllipseRowSpans(rt, xc, yc, y, 0, x2, quarter, c); });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//      lines
+// The three menu algorithms; see LineRaster.h for the pixels each picks.
+inline void DrawLineDDA(RenderTarget& rt, int x1, int y1, int x2, int y2, COLORREF c) {
+    DrawLine(rt, DDA, x1, y1, x2, y2, c);
+}
+
+inline void DrawLineBres(RenderTarget& rt, int x1, int y1, int x2, int y2, COLORREF c) {
+    DrawLine(rt, BRESENHAM, x1, y1, x2, y2, c);
+}
+
+inline void ParametricLine(RenderTarget& rt, int x1, int y1, int x2, int y2, COLORREF c1) {
+    DrawLine(rt, PARAMETRIC, x1, y1, x2, y2, c1);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// clipping window shared by the point, line and polygon clippers
+struct ClipWindow {
+    int xmin, ymin, xmax, ymax;
+};
+
+//clip point
+inline void clippingPoint(RenderTarget& rt, const ClipWindow& w, int x, int y, COLORREF c) {
+    if (x >= w.xmin && x <= w.xmax && y >= w.ymin && y <= w.ymax) {
+        SetPixel(rt, x, y, c);
+    }
+}
+//-----------------------------------------------------------------
+inline Point VIntersect(Point& p1, Point& p2, int xedge) {
+    Point result;
+    result.x = xedge;
+    if (p2.x - p1.x == 0)  // vertical line
+        result.y = p1.y;
+    else
+        result.y = ((xedge - p1.x) * (p2.y - p1.y) / (p2.x - p1.x)) + p1.y;
+    return result;
+}
+
+inline Point HIntersect(Point& p1, Point& p2, int yedge) {
+    Point result;
+    result.y = yedge;
+    if (p2.y - p1.y == 0)  // if line is horizontal
+        result.x = p1.x;
+    else
+        result.x = ((yedge - p1.y) * (p2.x - p1.x) / (p2.y - p1.y)) + p1.x;
+    return result;
+}
+
+// Liang-Barsky: the segment is p1 + t (p2 - p1), 0 <= t <= 1, and each
+// window side limits t from one end. Ends that move are rounded to the
+// nearest pixel (halves to even), exactly as ClipLines in LineClip.h does.
+inline bool ClipLine(const ClipWindow& w, Point& p1, Point& p2) {
+    double x1 = p1.x, y1 = p1.y, dx = (double)p2.x - p1.x, dy = (double)p2.y - p1.y;
+    const double p[4] = { -dx, dx, -dy, dy };
+    const double q[4] = { x1 - w.xmin, w.xmax - x1, y1 - w.ymin, w.ymax - y1 };
+    double t0 = 0, t1 = 1;
+    for (int k = 0; k < 4; k++) {
+        if (p[k] == 0) {
+            if (q[k] < 0) return false; // parallel to this side and outside it
+        }
+        else if (p[k] < 0) t0 = std::max(t0, q[k] / p[k]);
+        else t1 = std::min(t1, q[k] / p[k]);
+    }
+    if (t0 > t1) return false;
+    if (t1 < 1) p2 = Point((int)std::nearbyint(x1 + t1 * dx), (int)std::nearbyint(y1 + t1 * dy));
+    if (t0 > 0) p1 = Point((int)std::nearbyint(x1 + t0 * dx), (int)std::nearbyint(y1 + t0 * dy));
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////
+
+// Sutherland-Hodgman polygon clipping against the window [xl, xr] x [yt, yb].
+//
+// Each window side is its own small type, so the inside test and the
+// intersection inline into ClipPolygonEdge rather than being called through
+// pointers. The four passes alternate between two caller-owned buffers, and
+// polygons that lie wholly inside or wholly beyond one side skip the passes.
+struct ClipSideLeft {
+    int x;
+    bool In(const Point& v) const { return v.x >= x; }
+    Point Cross(Point v1, Point v2) const { return VIntersect(v1, v2, x); }
+};
+
+struct ClipSideRight {
+    int x;
+    bool In(const Point& v) const { return v.x <= x; }
+    Point Cross(Point v1, Point v2) const { return VIntersect(v1, v2, x); }
+};
+
+struct ClipSideTop {
+    int y;
+    bool In(const Point& v) const { return v.y >= y; }
+    Point Cross(Point v1, Point v2) const { return HIntersect(v1, v2, y); }
+};
+
+struct ClipSideBottom {
+    int y;
+    bool In(const Point& v) const { return v.y <= y; }
+    Point Cross(Point v1, Point v2) const { return HIntersect(v1, v2, y); }
+};
+
+// One pass: replaces out with p[0, n) clipped against a single side.
+template <typename Side>
+inline void ClipPolygonEdge(const Point* p, size_t n, Side side, std::vector<Point>& out) {
+    out.clear();
+    if (n == 0) return;
+    Point v1 = p[n - 1];
+    bool v1In = side.In(v1);
+    for (size_t i = 0; i < n; i++) {
+        Point v2 = p[i];
+        bool v2In = side.In(v2);
+        if (v1In != v2In) out.push_back(side.Cross(v1, v2));
+        if (v2In) out.push_back(v2);
+        v1 = v2;
+        v1In = v2In;
+    }
+}
+
+// Results of PolygonClipper::ClipAll laid end to end: polygon i is
+// points[starts[i], starts[i + 1]), empty if it was clipped away.
+struct ClippedPolygons {
+    std::vector<Point> points;
+    std::vector<size_t> starts;
+
+    size_t Count() const { return starts.empty() ? 0 : starts.size() - 1; }
+    const Point* Polygon(size_t i) const { return points.data() + starts[i]; }
+    size_t Size(size_t i) const { return starts[i + 1] - starts[i]; }
+};
+
+class PolygonClipper {
+public:
+    PolygonClipper(int xl = 0, int xr = 0, int yt = 0, int yb = 0) { SetWindow(xl, xr, yt, yb); }
+
+    void SetWindow(int xl, int xr, int yt, int yb) {
+        left.x = xl;
+        right.x = xr;
+        top.y = yt;
+        bottom.y = yb;
+    }
+
+    // The clipped polygon, valid until the next call.
+    const std::vector<Point>& Clip(const Point* p, size_t n) {
+        ClipInto(p, n, ping);
+        return ping;
+    }
+
+    // Clips every polygon against the same window into one flat result;
+    // after the first batch of a given size nothing is allocated.
+    template <typename Polygons>
+    void ClipAll(const Polygons& polygons, ClippedPolygons& out) {
+        out.points.clear();
+        out.starts.clear();
+        out.starts.push_back(0);
+        for (const auto& polygon : polygons) {
+            const std::vector<Point>& clipped = Clip(polygon.data(), polygon.size());
+            out.points.insert(out.points.end(), clipped.begin(), clipped.end());
+            out.starts.push_back(out.points.size());
+        }
+    }
+
+private:
+    void ClipInto(const Point* p, size_t n, std::vector<Point>& out) {
+        int xmin = INT_MAX, xmax = INT_MIN, ymin = INT_MAX, ymax = INT_MIN;
+        for (size_t i = 0; i < n; i++) {
+            xmin = std::min(xmin, p[i].x);
+            xmax = std::max(xmax, p[i].x);
+            ymin = std::min(ymin, p[i].y);
+            ymax = std::max(ymax, p[i].y);
+        }
+        if (n == 0 || xmax < left.x || xmin > right.x || ymax < top.y || ymin > bottom.y) {
+            out.clear();
+            return;
+        }
+        if (xmin >= left.x && xmax <= right.x && ymin >= top.y && ymax <= bottom.y) {
+            out.assign(p, p + n);
+            return;
+        }
+        ClipPolygonEdge(p, n, left, out);
+        ClipPolygonEdge(out.data(), out.size(), right, pong);
+        ClipPolygonEdge(pong.data(), pong.size(), top, out);
+        ClipPolygonEdge(out.data(), out.size(), bottom, pong);
+        out.swap(pong);
+    }
+
+    ClipSideLeft left;
+    ClipSideRight right;
+    ClipSideTop top;
+    ClipSideBottom bottom;
+    std::vector<Point> ping, pong;
+};
+
+// Closed outline through the vertices.
+inline void StrokePolygon(RenderTarget& rt, const Point* p, size_t n, COLORREF c) {
+    if (n == 0) return;
+    Point v1 = p[n - 1];
+    for (size_t i = 0; i < n; i++) {
+        DrawPenLine(rt, v1.x, v1.y, p[i].x, p[i].y, c);
+        v1 = p[i];
+    }
+}
+
+inline void PolygonClip(RenderTarget& rt, const Point* p, size_t n, int xl, int xr, int yt, int yb, COLORREF c) {
+    static thread_local PolygonClipper clipper;
+    clipper.SetWindow(xl, xr, yt, yb);
+    const std::vector<Point>& clipped = clipper.Clip(p, n);
+    StrokePolygon(rt, clipped.data(), clipped.size(), c);
+}
+
+//////////////////////////////////////////////////////////////////
+
+// Bezier
+
+// Exact forward differencing of a cubic Bernstein polynomial sampled at
+// t = i / n. Values are kept as q + r / n^3 with 0 <= r < n^3, so a step is
+// a few integer adds with carries and nothing drifts over many samples.
+struct CubicStepper {
+    long long m;
+    long long q[4], r[4]; // value, first, second and third difference
+
+    void Init(long long v0, long long v1, long long v2, long long v3, long long n) {
+        long long a = -v0 + 3 * v1 - 3 * v2 + v3, b = 3 * v0 - 6 * v1 + 3 * v2, c = -3 * v0 + 3 * v1;
+        m = n * n * n;
+        q[0] = v0;
+        r[0] = 0;
+        Split(1, a + b * n + c * n * n);
+        Split(2, 6 * a + 2 * b * n);
+        Split(3, 6 * a);
+    }
+
+    void Step() {
+        Add(0, 1);
+        Add(1, 2);
+        Add(2, 3);
+    }
+
+    long long Rounded() const { return q[0] + (2 * r[0] >= m); }
+
+private:
+    void Split(int k, long long v) {
+        q[k] = v / m;
+        r[k] = v % m;
+        if (r[k] < 0) { r[k] += m; q[k]--; }
+    }
+
+    void Add(int k, int d) {
+        q[k] += q[d];
+        r[k] += r[d];
+        if (r[k] >= m) { r[k] -= m; q[k]++; }
+    }
+};
+
+// Largest |B'(t)| on [0, 1] for one coordinate of a cubic Bezier. B'/3 is
+// the quadratic Bezier over the control-point differences, so its extreme
+// is at an end or at the vertex of that parabola.
+inline double BezierMaxSpeed(double v0, double v1, double v2, double v3) {
+    double d0 = v1 - v0, d1 = v2 - v1, d2 = v3 - v2;
+    double best = std::max(std::fabs(d0), std::fabs(d2));
+    double A = d0 - 2 * d1 + d2, B = 2 * (d1 - d0);
+    if (A != 0) {
+        double t = -B / (2 * A);
+        if (t > 0 && t < 1) best = std::max(best, std::fabs((A * t + B) * t + d0));
+    }
+    return 3 * best;
+}
+
+// Samples the curve just densely enough that neighbouring samples are at
+// most one pixel apart along each axis, so the step count follows the
+// curve's length and bends. Consecutive samples are then 8-connected, and a
+// sample landing on the previous pixel is skipped. The colour is the cubic
+// blend of c0..c3, stepped the same way.
+inline void DrawBezierCurve(RenderTarget& rt, Point p0, COLORREF c0, Point p1, COLORREF c1, Point p2, COLORREF c2, Point p3, COLORREF c3) {
+    // n^3 and the n^2 term must fit the steppers; curves longer than that
+    // get fewer samples, joined by lines
+    const long long MaxSteps = 1 << 20;
+    double speed = std::max(BezierMaxSpeed(p0.x, p1.x, p2.x, p3.x), BezierMaxSpeed(p0.y, p1.y, p2.y, p3.y));
+    long long n = std::min((long long)std::ceil(speed) + 1, MaxSteps);
+    while (n > 1 && speed * n * n > 4e18) n /= 2;
+
+    CubicStepper x, y, r = {}, g = {}, b = {}; // colours only step when blending
+    x.Init(p0.x, p1.x, p2.x, p3.x, n);
+    y.Init(p0.y, p1.y, p2.y, p3.y, n);
+    bool blend = c0 != c1 || c1 != c2 || c2 != c3;
+    if (blend) {
+        r.Init(GetRValue(c0), GetRValue(c1), GetRValue(c2), GetRValue(c3), n);
+        g.Init(GetGValue(c0), GetGValue(c1), GetGValue(c2), GetGValue(c3), n);
+        b.Init(GetBValue(c0), GetBValue(c1), GetBValue(c2), GetBValue(c3), n);
+    }
+
+    int px = p0.x, py = p0.y;
+    SetPixel(rt, px, py, c0);
+    for (long long i = 1; i <= n; i++) {
+        x.Step();
+        y.Step();
+        if (blend) {
+            r.Step();
+            g.Step();
+            b.Step();
+        }
+        int cx = (int)x.Rounded(), cy = (int)y.Rounded();
+        if (cx == px && cy == py) continue;
+        COLORREF c = blend ? RGB(r.Rounded(), g.Rounded(), b.Rounded()) : c0;
+        if (std::abs(cx - px) > 1 || std::abs(cy - py) > 1) DrawPenLine(rt, px, py, cx, cy, c);
+        SetPixel(rt, cx, cy, c);
+        px = cx;
+        py = cy;
+    }
+}
+
+// Hermite curves and cardinal splines are stroked as polylines with a
+// 2-pixel pen. FlattenHermite picks only as many chords as the tolerance
+// needs, so a curve that is repainted often can be flattened once and then
+// just stroked (see RefreshCurveOutline in Scene.h).
+const int CurvePenWidth = 2;
+const double DefaultCurveTolerance = 0.5;
+
+// Appends the segment p0 -> p1 as truncated vertices, skipping any that repeat
+// the previous one. The chord error of n equal steps along a cubic is at most
+// max|B''| / (8 n^2), and |B''| is bounded by 6 times the largest second
+// difference of the Bezier control points p0, p0 + t0/3, p1 - t1/3, p1.
+// out is a std::vector or a ScratchVector of Point.
+template <class Points>
+inline void FlattenHermite(Point p0, Point p1, Point t0, Point t1, double tolerance, Points& out) {
+    double bx[4] = { (double)p0.x, p0.x + t0.x / 3.0, p1.x - t1.x / 3.0, (double)p1.x };
+    double by[4] = { (double)p0.y, p0.y + t0.y / 3.0, p1.y - t1.y / 3.0, (double)p1.y };
+    double ddx = std::max(std::abs(bx[0] - 2 * bx[1] + bx[2]), std::abs(bx[1] - 2 * bx[2] + bx[3]));
+    double ddy = std::max(std::abs(by[0] - 2 * by[1] + by[2]), std::abs(by[1] - 2 * by[2] + by[3]));
+    double steps = std::ceil(std::sqrt(6 * std::sqrt(ddx * ddx + ddy * ddy) / (8 * std::max(tolerance, 0.01))));
+    int n = (int)std::min(std::max(steps, 1.0), 65536.0);
+
+    for (int i = 0; i <= n; i++) {
+        double t = (double)i / n;
+        double t2 = t * t;
+        double t3 = t2 * t;
+
+        double first = 2 * t3 - 3 * t2 + 1;
+        double second = t3 - 2 * t2 + t;
+        double third = -2 * t3 + 3 * t2;
+        double fourth = t3 - t2;
+
+        Point p((int)(first * p0.x + second * t0.x + third * p1.x + fourth * t1.x),
+            (int)(first * p0.y + second * t0.y + third * p1.y + fourth * t1.y));
+        if (!out.empty() && out.back().x == p.x && out.back().y == p.y) continue;
+        out.push_back(p);
+    }
+}
+
+// Joins the vertices, moved by (dx, dy), with DrawPenLine; as with GDI's
+// Polyline the last vertex itself is not drawn.
+inline void StrokePolyline(RenderTarget& rt, const Point* pts, size_t n, COLORREF c, int width, int dx = 0, int dy = 0) {
+    for (size_t i = 1; i < n; i++)
+        DrawPenLine(rt, pts[i - 1].x + dx, pts[i - 1].y + dy, pts[i].x + dx, pts[i].y + dy, c, width);
+}
+
+inline void DrawHermiteCurve(RenderTarget& rt, Point p0, Point p1, Point t0, Point t1, COLORREF color) {
+    ScratchVector<Point> pts;
+    FlattenHermite(p0, p1, t0, t1, DefaultCurveTolerance, pts);
+    StrokePolyline(rt, pts.data(), pts.size(), color, CurvePenWidth);
+}
+
+// Calls segment(p0, p1, t0, t1) for each Hermite piece of the cardinal spline
+// through the n points of P. The end points are doubled, so the spline
+// passes through every point; tangents are (1 - c) times the chord between
+// the neighbours.
+template <typename Segment>
+inline void ForEachCardinalSegment(const Point* P, int n, double c, Segment segment) {
+    if (n < 2) return;
+    auto at = [&](int i) { return P[std::min(std::max(i, 0), n - 1)]; };
+
+    double c1 = 1 - c;
+    Point T0((int)(c1 * (at(1).x - at(-1).x)), (int)(c1 * (at(1).y - at(-1).y)));
+    for (int i = 1; i <= n; i++) {
+        Point T1((int)(c1 * (at(i + 1).x - at(i - 1).x)), (int)(c1 * (at(i + 1).y - at(i - 1).y)));
+        segment(at(i - 1), at(i), T0, T1);
+        T0 = T1;
+    }
+}
+
+template <class Points>
+inline void FlattenCardinalSpline(const Point* P, int n, double c, double tolerance, Points& out) {
+    ForEachCardinalSegment(P, n, c, [&](Point p0, Point p1, Point t0, Point t1) {
+        FlattenHermite(p0, p1, t0, t1, tolerance, out);
+    });
+}
+
+inline void DrawCardinalSpline(RenderTarget& rt, const Point* P, int n, double c, COLORREF color1)
+{
+    ScratchVector<Point> pts;
+    FlattenCardinalSpline(P, n, c, DefaultCurveTolerance, pts);
+    StrokePolyline(rt, pts.data(), pts.size(), color1, CurvePenWidth);
+}
+
+// Outline of an axis-aligned box drawn with the default (black, 1px) pen.
+inline void DrawBoxOutline(RenderTarget& rt, int left, int top, int right, int bottom, COLORREF c, int width = 1) {
+    DrawPenLine(rt, left, top, right, top, c, width);
+    DrawPenLine(rt, right, top, right, bottom, c, width);
+    DrawPenLine(rt, right, bottom, left, bottom, c, width);
+    DrawPenLine(rt, left, bottom, left, top, c, width);
+}
+
+inline void FillSquareWithHermiteCurve(RenderTarget& rt, Point topLeft, int size, COLORREF color) {
+    DrawBoxOutline(rt, topLeft.x, topLeft.y, topLeft.x + size, topLeft.y + size, RGB(0, 0, 0));
+    // every column is the same curve moved sideways
+    ScratchVector<Point> column;
+    FlattenHermite(topLeft, Point(topLeft.x, topLeft.y + size), Point(0, size / 4), Point(0, -size / 4),
+        DefaultCurveTolerance, column);
+    for (int dx = 0; dx <= size; dx += 2)
+        StrokePolyline(rt, column.data(), column.size(), color, CurvePenWidth, dx);
+}
+
+inline void FillRectangleWithBezierCurve(RenderTarget& rt, Point topLeft, Point bottomRight, COLORREF color) {
+    DrawBoxOutline(rt, topLeft.x, topLeft.y, bottomRight.x, bottomRight.y, RGB(0, 0, 0));
+
+    // Every row is a single-colour Bezier with its control points evenly
+    // spaced on the row, which covers exactly the span between its ends.
+    for (int y = topLeft.y; y <= bottomRight.y; y += 1)
+        FillSpan(rt, topLeft.x, bottomRight.x, y, color);
+}
+
+inline void DrawEmptySquare(RenderTarget& rt, Point topLeft, int size, COLORREF color) {
+    DrawBoxOutline(rt, topLeft.x, topLeft.y, topLeft.x + size, topLeft.y + size, color, 2);
+}
+
+inline void FloodFillRecursive(RenderTarget& rt, int x, int y, COLORREF fillColor, COLORREF boundaryColor) {
+    if (x < 0 || x >= rt.width || y < 0 || y >= rt.height) return;
+    COLORREF currentColor = GetPixel(rt, x, y);
+    if (currentColor == boundaryColor || currentColor == fillColor) return;
+    SetPixel(rt, x, y, fillColor);
+    FloodFillRecursive(rt, x + 1, y, fillColor, boundaryColor);
+    FloodFillRecursive(rt, x - 1, y, fillColor, boundaryColor);
+    FloodFillRecursive(rt, x, y + 1, fillColor, boundaryColor);
+    FloodFillRecursive(rt, x, y - 1, fillColor, boundaryColor);
+}
+
+inline void FloodFillNonRecursive(RenderTarget& rt, int x, int y, COLORREF fillColor, COLORREF boundaryColor) {
+    std::stack<Point> stack;
+    stack.push(Point(x, y));
+    while (!stack.empty()) {
+        Point p = stack.top();
+        stack.pop();
+        COLORREF currentColor = GetPixel(rt, p.x, p.y);
+        if (currentColor == CLR_INVALID) continue;
+        if (currentColor == boundaryColor || currentColor == fillColor) continue;
+        SetPixel(rt, p.x, p.y, fillColor);
+        stack.push(Point(p.x + 1, p.y));
+        stack.push(Point(p.x - 1, p.y));
+        stack.push(Point(p.x, p.y + 1));
+        stack.push(Point(p.x, p.y - 1));
+    }
+}
+
+// Scanline polygon fill over contiguous edge arrays. Only the rows the
+// polygon covers inside rt.clip are visited, so any canvas height works,
+// and the scratch arrays keep their capacity between calls: a filler that
+// is reused does not allocate once it has seen its largest polygon.
+//
+// Edges own the rows [top, bottom) of their span and cross a row at
+// x = x0 + dx * (y - y0) / dy; the pixels from ceil(left) to floor(right) of
+// each covered interval are filled. Both ends are exact integer divisions
+// made afresh on each row, so a clip that starts the walk lower (a tile, a
+// damaged area) leaves the same pixels as drawing the whole polygon.
+enum FillRule { FILL_EVEN_ODD, FILL_NON_ZERO };
+
+class ScanlinePolygonFill {
+public:
+    // The active edge list is kept sorted by x: entering edges are inserted
+    // in place and after each step an insertion sort repairs the few edges
+    // that crossed, so no row is sorted from scratch.
+    void Fill(RenderTarget& rt, const Point* p, int n, COLORREF c, FillRule rule = FILL_EVEN_ODD) {
+        int y, yEnd;
+        if (!BuildEdges(rt, p, n, y, yEnd)) return;
+        std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.top < b.top; });
+
+        active.clear();
+        size_t next = 0;
+        while (y < yEnd) {
+            if (active.empty()) {
+                if (next == edges.size()) break;
+                y = std::max(y, edges[next].top);
+                if (y >= yEnd) break;
+            }
+            for (; next < edges.size() && edges[next].top <= y; next++) {
+                Edge e = edges[next];
+                e.x = e.At(y);
+                active.insert(std::upper_bound(active.begin(), active.end(), e,
+                    [](const Edge& a, const Edge& b) { return a.x < b.x; }), e);
+            }
+
+            int winding = 0;
+            for (size_t i = 0; i + 1 < active.size(); i++) {
+                winding += rule == FILL_EVEN_ODD ? 1 : active[i].direction;
+                bool inside = rule == FILL_EVEN_ODD ? (winding & 1) != 0 : winding != 0;
+                if (!inside) continue;
+                int x1 = active[i].Ceil(y), x2 = active[i + 1].Floor(y);
+                if (x1 <= x2) FillSpan(rt, x1, x2, y, c);
+            }
+
+            y++;
+            size_t kept = 0;
+            for (size_t i = 0; i < active.size(); i++) {
+                if (active[i].bottom <= y) continue;
+                active[kept] = active[i];
+                active[kept].x = active[kept].At(y);
+                for (size_t j = kept; j > 0 && active[j].x < active[j - 1].x; j--) std::swap(active[j], active[j - 1]);
+                kept++;
+            }
+            active.resize(kept);
+        }
+    }
+
+    // Fills, on each row, from the leftmost to the rightmost edge crossing;
+    // for a convex polygon that is its interior, found without an active
+    // edge list.
+    void FillConvex(RenderTarget& rt, const Point* p, int n, COLORREF c) {
+        int yBegin, yEnd;
+        if (!BuildEdges(rt, p, n, yBegin, yEnd)) return;
+        rows.assign((size_t)(yEnd - yBegin), Entry{ INT_MAX, INT_MIN });
+        for (const Edge& e : edges) {
+            int y0 = std::max(e.top, yBegin), y1 = std::min(e.bottom, yEnd);
+            for (int y = y0; y < y1; y++) {
+                Entry& row = rows[y - yBegin];
+                row.xmin = std::min(row.xmin, e.Ceil(y));
+                row.xmax = std::max(row.xmax, e.Floor(y));
+            }
+        }
+        for (int y = yBegin; y < yEnd; y++) {
+            const Entry& row = rows[y - yBegin];
+            if (row.xmin < row.xmax) FillSpan(rt, row.xmin, row.xmax, y, c);
+        }
+    }
+
+private:
+    struct Edge {
+        double x;       // crossing of the current row, for ordering the active list
+        long long x0, dx, dy; // from (x0, top), dy > 0
+        int top, bottom;
+        int direction;  // +1 if the polygon runs down this edge, -1 if up
+
+        double At(int y) const { return x0 + (double)dx * (y - top) / dy; }
+        int Ceil(int y) const { return (int)LineCeilDiv(x0 * dy + dx * (y - top), dy); }
+        int Floor(int y) const { return (int)LineFloorDiv(x0 * dy + dx * (y - top), dy); }
+    };
+
+    // Collects the non-horizontal edges that reach rt.clip and the rows
+    // [yBegin, yEnd) worth scanning; false if there are none.
+    bool BuildEdges(const RenderTarget& rt, const Point* p, int n, int& yBegin, int& yEnd) {
+        edges.clear();
+        yBegin = INT_MAX;
+        yEnd = INT_MIN;
+        for (int i = 0; i < n; i++) {
+            Point v1 = p[i == 0 ? n - 1 : i - 1], v2 = p[i];
+            if (v1.y == v2.y) continue;
+            Edge e;
+            e.direction = v1.y < v2.y ? 1 : -1;
+            if (v1.y > v2.y) std::swap(v1, v2);
+            if (v2.y <= rt.clip.top || v1.y >= rt.clip.bottom) continue;
+            e.x0 = v1.x;
+            e.dx = (long long)v2.x - v1.x;
+            e.dy = (long long)v2.y - v1.y;
+            e.x = (double)e.x0;
+            e.top = v1.y;
+            e.bottom = v2.y;
+            edges.push_back(e);
+            yBegin = std::min(yBegin, e.top);
+            yEnd = std::max(yEnd, e.bottom);
+        }
+        yBegin = std::max(yBegin, rt.clip.top);
+        yEnd = std::min(yEnd, rt.clip.bottom);
+        return yBegin < yEnd;
+    }
+
+    std::vector<Edge> edges;
+    std::vector<Edge> active;
+    std::vector<Entry> rows;
+};
+
+// One filler per thread, so tiles rendered in parallel each reuse their own.
+inline ScanlinePolygonFill& ThreadPolygonFill() {
+    static thread_local ScanlinePolygonFill filler;
+    return filler;
+}
+
+inline void ConvexFill(RenderTarget& rt, const Point p[], int n, COLORREF color) {
+    ThreadPolygonFill().FillConvex(rt, p, n, color);
+}
+
+inline void GeneralPolygonFill(RenderTarget& rt, const Point* polygon, int n, COLORREF c, FillRule rule = FILL_EVEN_ODD) {
+    ThreadPolygonFill().Fill(rt, polygon, n, c, rule);
+}
+
+
+//////////////////////////////////////////////////////////////////
+// Bounds
+//
+// Rectangles guaranteed to hold every pixel the routines above write for a
+// shape. They are widened by BoundsPadding to absorb the 2px pens and the
+// rounding of the floating-point rasterizers, so a repaint limited to them
+// never leaves stale pixels behind.
+
+const int BoundsPadding = 2;
+
+// Inclusive pixel extent to padded PixelRect.
+inline PixelRect PaddedBounds(int xmin, int ymin, int xmax, int ymax) {
+    PixelRect r = { xmin - BoundsPadding, ymin - BoundsPadding,
+        xmax + 1 + BoundsPadding, ymax + 1 + BoundsPadding };
+    return r;
+}
+
+inline PixelRect LineBounds(int x1, int y1, int x2, int y2) {
+    return PaddedBounds(std::min(x1, x2), std::min(y1, y2), std::max(x1, x2), std::max(y1, y2));
+}
+
+inline PixelRect CircleBounds(int xc, int yc, int R) {
+    R = std::abs(R);
+    return PaddedBounds(xc - R, yc - R, xc + R, yc + R);
+}
+
+inline PixelRect EllipseBounds(int xc, int yc, int a, int b) {
+    a = std::abs(a);
+    b = std::abs(b);
+    return PaddedBounds(xc - a, yc - b, xc + a, yc + b);
+}
+
+inline PixelRect PointsBounds(const Point* p, int n) {
+    if (n <= 0) {
+        PixelRect none = { 0, 0, 0, 0 };
+        return none;
+    }
+    int xmin = p[0].x, xmax = p[0].x, ymin = p[0].y, ymax = p[0].y;
+    for (int i = 1; i < n; i++) {
+        xmin = std::min(xmin, p[i].x);
+        xmax = std::max(xmax, p[i].x);
+        ymin = std::min(ymin, p[i].y);
+        ymax = std::max(ymax, p[i].y);
+    }
+    return PaddedBounds(xmin, ymin, xmax, ymax);
+}
+
+// A cubic stays inside the hull of its Bezier control points; for a Hermite
+// segment those are p0, p0 + t0/3, p1 - t1/3 and p1.
+inline PixelRect HermiteBounds(Point p0, Point p1, Point t0, Point t1) {
+    double xs[4] = { (double)p0.x, p0.x + t0.x / 3.0, p1.x - t1.x / 3.0, (double)p1.x };
+    double ys[4] = { (double)p0.y, p0.y + t0.y / 3.0, p1.y - t1.y / 3.0, (double)p1.y };
+    return PaddedBounds((int)std::floor(*std::min_element(xs, xs + 4)), (int)std::floor(*std::min_element(ys, ys + 4)),
+        (int)std::ceil(*std::max_element(xs, xs + 4)), (int)std::ceil(*std::max_element(ys, ys + 4)));
+}
+
+inline PixelRect CardinalSplineBounds(const Point* P, int n, double c) {
+    PixelRect r = { 0, 0, 0, 0 };
+    ForEachCardinalSegment(P, n, c, [&](Point p0, Point p1, Point t0, Point t1) {
+        r = Union(r, HermiteBounds(p0, p1, t0, t1));
+    });
+    return r;
+}
@@ -0,0 +1,963 @@
+#pragma once
+
+// Stored shapes, the scene that owns them and the full-scene renderer.
+// Shared by the Win32 app and the headless tools.
+
+#include <vector>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include "Raster.h"
+#include "LineClip.h"
+#include "OutlineCache.h"
+
+
+// Value form of one shape, used to add it to a Scene and returned when a
+// row is read back; the Scene itself stores them column by column.
+struct Line {
+    int x1, y1, x2, y2;
+    COLORREF color;
+    int algorithm;
+};
+
+struct Circle {
+    int xc, yc, R;
+    COLORREF color;
+    int quarter; // 1 to 4 for quarter-based drawing
+    int algorithm; // 0: Direct, 1: Polar, 2: Iterative Polar, 3: Midpoint, 4: Modified Midpoint, 5: Fill Lines, 6: Fill Circles
+};
+
+struct BezierCurve {
+    Point p0, p1, p2, p3;
+    COLORREF c0, c1, c2, c3;
+};
+
+struct HermiteCurve {
+    Point p0, p1, t0, t1;
+    COLORREF color;
+};
+
+struct Ellipsee {
+    int xc, yc, a, b;
+    COLORREF color;
+    int quarter; // 1 to 4 for quarter-based drawing
+    int algorithm; // 0: Direct, 1: Polar, 2: Midpoint
+};
+
+enum ClippingMethod { None = 0, RECTANGLE = 1, SQUARE = 2 };
+
+// Shapes drawn from the Advanced menu. The names are how scene files spell
+// them.
+enum AdvancedKind { ADVANCED_SQUARE_HERMITE, ADVANCED_RECTANGLE_BEZIER, ADVANCED_EMPTY_SQUARE, ADVANCED_POLYGON_CONVEX,
+    ADVANCED_POLYGON_NONCONVEX, ADVANCED_FLOOD_RECURSIVE, ADVANCED_FLOOD_NONRECURSIVE, ADVANCED_KIND_COUNT };
+
+static const char* const AdvancedKindNames[ADVANCED_KIND_COUNT] = {
+    "square_hermite", "rectangle_bezier", "empty_square", "polygon_convex",
+    "polygon_nonconvex", "flood_recursive", "flood_nonrecursive"
+};
+
+inline bool AdvancedKindFromName(const char* name, size_t length, AdvancedKind& kind) {
+    for (int k = 0; k < ADVANCED_KIND_COUNT; k++) {
+        if (std::strlen(AdvancedKindNames[k]) == length && std::memcmp(AdvancedKindNames[k], name, length) == 0) {
+            kind = (AdvancedKind)k;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct ClipRect {
+    int left, top, right, bottom;
+};
+
+
+// Shape tables of a Scene, numbered in the order DrawAllShapes paints them,
+// so sorting ShapeRefs reproduces the painting order.
+enum ShapeKind { SHAPE_LINES, SHAPE_POINTS, SHAPE_CIRCLES, SHAPE_ELLIPSES, SHAPE_POLYGONS,
+    SHAPE_BEZIERS, SHAPE_HERMITES, SHAPE_SPLINES, SHAPE_ADVANCED, SHAPE_KIND_COUNT };
+
+struct ShapeRef {
+    ShapeKind kind;
+    int index;
+
+    bool operator<(const ShapeRef& o) const { return kind != o.kind ? kind < o.kind : index < o.index; }
+    bool operator==(const ShapeRef& o) const { return kind == o.kind && index == o.index; }
+};
+
+// Row of one table, as returned by the Scene's Add functions. Rows are only
+// ever appended, so a handle stays valid until the scene is cleared or
+// replaced.
+template <ShapeKind K>
+struct ShapeHandle {
+    int index;
+
+    operator ShapeRef() const {
+        ShapeRef ref = { K, index };
+        return ref;
+    }
+};
+
+typedef ShapeHandle<SHAPE_LINES> LineHandle;
+typedef ShapeHandle<SHAPE_POINTS> PointHandle;
+typedef ShapeHandle<SHAPE_CIRCLES> CircleHandle;
+typedef ShapeHandle<SHAPE_ELLIPSES> EllipseHandle;
+typedef ShapeHandle<SHAPE_POLYGONS> PolygonHandle;
+typedef ShapeHandle<SHAPE_BEZIERS> BezierHandle;
+typedef ShapeHandle<SHAPE_HERMITES> HermiteHandle;
+typedef ShapeHandle<SHAPE_SPLINES> SplineHandle;
+typedef ShapeHandle<SHAPE_ADVANCED> AdvancedHandle;
+
+// Points [first, first + count) of one of the Scene's point pools.
+struct PointRange {
+    int first, count;
+};
+
+struct PointSpan {
+    const Point* data;
+    int count;
+
+    const Point* begin() const { return data; }
+    const Point* end() const { return data + count; }
+    const Point& operator[](int i) const { return data[i]; }
+};
+
+
+// One table per shape kind, one column per field. Drawing, saving and
+// clipping walk a few columns front to back instead of hopping between
+// heap blocks. Shapes with a variable number of points keep a PointRange
+// into Scene::vertices; flattened curves keep one into Scene::outlines,
+// with a tolerance of 0 until RefreshCurveOutline builds it.
+struct LineTable {
+    LineArrays ends; // x1, y1, x2, y2; ClipLines reads these directly
+    std::vector<COLORREF> color;
+    std::vector<int> algorithm;
+
+    int Size() const { return (int)color.size(); }
+
+    void Reserve(size_t n) {
+        ends.Reserve(n);
+        color.reserve(n);
+        algorithm.reserve(n);
+    }
+
+    void Clear() {
+        ends.Clear();
+        color.clear();
+        algorithm.clear();
+    }
+
+    void Push(const Line& l) {
+        ends.Push(l.x1, l.y1, l.x2, l.y2);
+        color.push_back(l.color);
+        algorithm.push_back(l.algorithm);
+    }
+
+    Line operator[](int i) const {
+        Line l = { ends.x1[i], ends.y1[i], ends.x2[i], ends.y2[i], color[i], algorithm[i] };
+        return l;
+    }
+};
+
+struct PointTable {
+    std::vector<int> x, y;
+
+    int Size() const { return (int)x.size(); }
+
+    void Reserve(size_t n) {
+        x.reserve(n);
+        y.reserve(n);
+    }
+
+    void Clear() {
+        x.clear();
+        y.clear();
+    }
+
+    void Push(Point p) {
+        x.push_back(p.x);
+        y.push_back(p.y);
+    }
+
+    Point operator[](int i) const { return Point(x[i], y[i]); }
+};
+
+struct CircleTable {
+    std::vector<int> xc, yc, R;
+    std::vector<COLORREF> color;
+    std::vector<int> quarter, algorithm;
+
+    int Size() const { return (int)xc.size(); }
+
+    void Reserve(size_t n) {
+        xc.reserve(n);
+        yc.reserve(n);
+        R.reserve(n);
+        color.reserve(n);
+        quarter.reserve(n);
+        algorithm.reserve(n);
+    }
+
+    void Clear() {
+        xc.clear();
+        yc.clear();
+        R.clear();
+        color.clear();
+        quarter.clear();
+        algorithm.clear();
+    }
+
+    void Push(const Circle& c) {
+        xc.push_back(c.xc);
+        yc.push_back(c.yc);
+        R.push_back(c.R);
+        color.push_back(c.color);
+        quarter.push_back(c.quarter);
+        algorithm.push_back(c.algorithm);
+    }
+
+    Circle operator[](int i) const {
+        Circle c = { xc[i], yc[i], R[i], color[i], quarter[i], algorithm[i] };
+        return c;
+    }
+};
+
+struct EllipseTable {
+    std::vector<int> xc, yc, a, b;
+    std::vector<COLORREF> color;
+    std::vector<int> quarter, algorithm;
+
+    int Size() const { return (int)xc.size(); }
+
+    void Reserve(size_t n) {
+        xc.reserve(n);
+        yc.reserve(n);
+        a.reserve(n);
+        b.reserve(n);
+        color.reserve(n);
+        quarter.reserve(n);
+        algorithm.reserve(n);
+    }
+
+    void Clear() {
+        xc.clear();
+        yc.clear();
+        a.clear();
+        b.clear();
+        color.clear();
+        quarter.clear();
+        algorithm.clear();
+    }
+
+    void Push(const Ellipsee& e) {
+        xc.push_back(e.xc);
+        yc.push_back(e.yc);
+        a.push_back(e.a);
+        b.push_back(e.b);
+        color.push_back(e.color);
+        quarter.push_back(e.quarter);
+        algorithm.push_back(e.algorithm);
+    }
+
+    Ellipsee operator[](int i) const {
+        Ellipsee e = { xc[i], yc[i], a[i], b[i], color[i], quarter[i], algorithm[i] };
+        return e;
+    }
+};
+
+// Clipped polygons keep the window they were drawn under.
+struct PolygonTable {
+    std::vector<PointRange> points;
+    std::vector<int> xl, xr, yt, yb;
+    std::vector<COLORREF> color;
+
+    int Size() const { return (int)points.size(); }
+
+    void Reserve(size_t n) {
+        points.reserve(n);
+        xl.reserve(n);
+        xr.reserve(n);
+        yt.reserve(n);
+        yb.reserve(n);
+        color.reserve(n);
+    }
+
+    void Clear() {
+        points.clear();
+        xl.clear();
+        xr.clear();
+        yt.clear();
+        yb.clear();
+        color.clear();
+    }
+
+    void Push(PointRange range, int left, int right, int top, int bottom, COLORREF c) {
+        points.push_back(range);
+        xl.push_back(left);
+        xr.push_back(right);
+        yt.push_back(top);
+        yb.push_back(bottom);
+        color.push_back(c);
+    }
+};
+
+struct BezierTable {
+    std::vector<Point> p0, p1, p2, p3;
+    std::vector<COLORREF> c0, c1, c2, c3;
+
+    int Size() const { return (int)p0.size(); }
+
+    void Reserve(size_t n) {
+        p0.reserve(n);
+        p1.reserve(n);
+        p2.reserve(n);
+        p3.reserve(n);
+        c0.reserve(n);
+        c1.reserve(n);
+        c2.reserve(n);
+        c3.reserve(n);
+    }
+
+    void Clear() {
+        p0.clear();
+        p1.clear();
+        p2.clear();
+        p3.clear();
+        c0.clear();
+        c1.clear();
+        c2.clear();
+        c3.clear();
+    }
+
+    void Push(const BezierCurve& b) {
+        p0.push_back(b.p0);
+        p1.push_back(b.p1);
+        p2.push_back(b.p2);
+        p3.push_back(b.p3);
+        c0.push_back(b.c0);
+        c1.push_back(b.c1);
+        c2.push_back(b.c2);
+        c3.push_back(b.c3);
+    }
+
+    BezierCurve operator[](int i) const {
+        BezierCurve b = { p0[i], p1[i], p2[i], p3[i], c0[i], c1[i], c2[i], c3[i] };
+        return b;
+    }
+};
+
+struct HermiteTable {
+    std::vector<Point> p0, p1, t0, t1;
+    std::vector<COLORREF> color;
+    std::vector<PointRange> outline;
+    std::vector<double> outlineTolerance;
+
+    int Size() const { return (int)p0.size(); }
+
+    void Reserve(size_t n) {
+        p0.reserve(n);
+        p1.reserve(n);
+        t0.reserve(n);
+        t1.reserve(n);
+        color.reserve(n);
+        outline.reserve(n);
+        outlineTolerance.reserve(n);
+    }
+
+    void Clear() {
+        p0.clear();
+        p1.clear();
+        t0.clear();
+        t1.clear();
+        color.clear();
+        outline.clear();
+        outlineTolerance.clear();
+    }
+
+    void Push(const HermiteCurve& h) {
+        p0.push_back(h.p0);
+        p1.push_back(h.p1);
+        t0.push_back(h.t0);
+        t1.push_back(h.t1);
+        color.push_back(h.color);
+        outline.push_back(PointRange{ 0, 0 });
+        outlineTolerance.push_back(0);
+    }
+
+    HermiteCurve operator[](int i) const {
+        HermiteCurve h = { p0[i], p1[i], t0[i], t1[i], color[i] };
+        return h;
+    }
+};
+
+// Cardinal splines through their points, with tension c.
+struct SplineTable {
+    std::vector<PointRange> points;
+    std::vector<double> c;
+    std::vector<COLORREF> color;
+    std::vector<PointRange> outline;
+    std::vector<double> outlineTolerance;
+
+    int Size() const { return (int)points.size(); }
+
+    void Reserve(size_t n) {
+        points.reserve(n);
+        c.reserve(n);
+        color.reserve(n);
+        outline.reserve(n);
+        outlineTolerance.reserve(n);
+    }
+
+    void Clear() {
+        points.clear();
+        c.clear();
+        color.clear();
+        outline.clear();
+        outlineTolerance.clear();
+    }
+
+    void Push(PointRange range, double tension, COLORREF col) {
+        points.push_back(range);
+        c.push_back(tension);
+        color.push_back(col);
+        outline.push_back(PointRange{ 0, 0 });
+        outlineTolerance.push_back(0);
+    }
+};
+
+struct AdvancedTable {
+    std::vector<AdvancedKind> kind;
+    std::vector<PointRange> points;
+    std::vector<COLORREF> color;
+    // Colour a flood fill stops at; CLR_INVALID for the other kinds, and
+    // for fills from files that did not store it.
+    std::vector<COLORREF> boundary;
+
+    int Size() const { return (int)kind.size(); }
+
+    void Reserve(size_t n) {
+        kind.reserve(n);
+        points.reserve(n);
+        color.reserve(n);
+        boundary.reserve(n);
+    }
+
+    void Clear() {
+        kind.clear();
+        points.clear();
+        color.clear();
+        boundary.clear();
+    }
+
+    void Push(AdvancedKind k, PointRange range, COLORREF c, COLORREF boundaryColor = CLR_INVALID) {
+        kind.push_back(k);
+        points.push_back(range);
+        color.push_back(c);
+        boundary.push_back(boundaryColor);
+    }
+};
+
+inline bool IsFloodFill(AdvancedKind kind) {
+    return kind == ADVANCED_FLOOD_RECURSIVE || kind == ADVANCED_FLOOD_NONRECURSIVE;
+}
+
+
+struct Scene {
+    LineTable lines;
+    PointTable points;
+    CircleTable circles;
+    EllipseTable ellipses;
+    PolygonTable polygons;
+    BezierTable beziers;
+    HermiteTable hermites;
+    SplineTable splines;
+    AdvancedTable advanced;
+
+    std::vector<Point> vertices; // polygons, splines and advanced shapes
+    std::vector<Point> outlines; // flattened Hermite curves and splines
+
+    ClippingMethod currentClippingMethod = None;
+    ClipRect clippingRect = { 0, 0, 0, 0 };
+    bool clippingEnabled = false;
+    ClipRect clippingSquare = { 0, 0, 0, 0 };
+    bool clippingEnabledSquare = false;
+    bool clippingRectDrawn = false;
+    bool clippingSquareDrawn = false;
+
+    LineHandle Add(const Line& l) {
+        lines.Push(l);
+        return LineHandle{ lines.Size() - 1 };
+    }
+
+    PointHandle Add(Point p) {
+        points.Push(p);
+        return PointHandle{ points.Size() - 1 };
+    }
+
+    CircleHandle Add(const Circle& c) {
+        circles.Push(c);
+        return CircleHandle{ circles.Size() - 1 };
+    }
+
+    EllipseHandle Add(const Ellipsee& e) {
+        ellipses.Push(e);
+        return EllipseHandle{ ellipses.Size() - 1 };
+    }
+
+    BezierHandle Add(const BezierCurve& b) {
+        beziers.Push(b);
+        return BezierHandle{ beziers.Size() - 1 };
+    }
+
+    HermiteHandle Add(const HermiteCurve& h) {
+        hermites.Push(h);
+        return HermiteHandle{ hermites.Size() - 1 };
+    }
+
+    PolygonHandle AddPolygon(const Point* p, int n, int xl, int xr, int yt, int yb, COLORREF color) {
+        polygons.Push(AddVertices(p, n), xl, xr, yt, yb, color);
+        return PolygonHandle{ polygons.Size() - 1 };
+    }
+
+    SplineHandle AddSpline(const Point* p, int n, double c, COLORREF color) {
+        splines.Push(AddVertices(p, n), c, color);
+        return SplineHandle{ splines.Size() - 1 };
+    }
+
+    AdvancedHandle AddAdvanced(AdvancedKind kind, const Point* p, int n, COLORREF color) {
+        advanced.Push(kind, AddVertices(p, n), color);
+        return AdvancedHandle{ advanced.Size() - 1 };
+    }
+
+    // A flood fill of color from seed that stops at boundary; kind is one
+    // of the two flood kinds.
+    AdvancedHandle AddFloodFill(AdvancedKind kind, Point seed, COLORREF color, COLORREF boundary) {
+        advanced.Push(kind, AddVertices(&seed, 1), color, boundary);
+        return AdvancedHandle{ advanced.Size() - 1 };
+    }
+
+    PointRange AddVertices(const Point* p, int n) {
+        PointRange range = { (int)vertices.size(), n };
+        vertices.insert(vertices.end(), p, p + n);
+        return range;
+    }
+
+    PointSpan Vertices(PointRange range) const {
+        PointSpan span = { vertices.data() + range.first, range.count };
+        return span;
+    }
+
+    PointSpan Outline(PointRange range) const {
+        PointSpan span = { outlines.data() + range.first, range.count };
+        return span;
+    }
+
+    // Drops every shape (the clipping state stays); handles taken before
+    // are no longer valid.
+    void ClearShapes() {
+        lines.Clear();
+        points.Clear();
+        circles.Clear();
+        ellipses.Clear();
+        polygons.Clear();
+        beziers.Clear();
+        hermites.Clear();
+        splines.Clear();
+        advanced.Clear();
+        vertices.clear();
+        outlines.clear();
+    }
+};
+
+
+// The same pixels DrawLineBres gives each edge, ends included.
+inline void DrawClippingRectangle(RenderTarget& rt, const ClipWindow& w) {
+    const COLORREF red = RGB(255, 0, 0);
+    FillSpan(rt, w.xmin, w.xmax, w.ymin, red);
+    FillSpan(rt, w.xmin, w.xmax, w.ymax, red);
+    for (int y = std::min(w.ymin, w.ymax); y <= std::max(w.ymin, w.ymax); y++) {
+        SetPixel(rt, w.xmin, y, red);
+        SetPixel(rt, w.xmax, y, red);
+    }
+}
+
+// Window the stored lines and points are clipped against on repaint.
+inline ClipWindow ActiveClipWindow(const Scene& scene) {
+    ClipWindow w;
+    if (scene.currentClippingMethod == RECTANGLE && scene.clippingEnabled) {
+        w.xmin = scene.clippingRect.left;
+        w.ymin = scene.clippingRect.top;
+        w.xmax = scene.clippingRect.right;
+        w.ymax = scene.clippingRect.bottom;
+    }
+    else if (scene.currentClippingMethod == SQUARE && scene.clippingEnabledSquare) {
+        w.xmin = scene.clippingSquare.left;
+        w.ymin = scene.clippingSquare.top;
+        w.xmax = scene.clippingSquare.right;
+        w.ymax = scene.clippingSquare.bottom;
+    }
+    else {
+        w.xmin = w.ymin = INT_MIN;
+        w.xmax = w.ymax = INT_MAX;
+    }
+    return w;
+}
+
+inline void DrawLineWith(RenderTarget& rt, int algorithm, int x1, int y1, int x2, int y2, COLORREF c) {
+    if (algorithm >= DDA && algorithm <= PARAMETRIC) DrawLine(rt, (LineAlgorithm)algorithm, x1, y1, x2, y2, c);
+}
+
+// Outlines come from the shared OutlineCache, so a scene full of circles
+// of a few sizes computes each size once.
+inline void DrawCircleShape(RenderTarget& rt, const Circle& circle) {
+    switch (circle.algorithm) {
+    case FILL_LINES:
+        FillCircleWithLines(rt, circle.xc, circle.yc, circle.R, circle.quarter, circle.color);
+        break;
+    case FILL_CIRCLES:
+        FillCircleWithCircles(rt, circle.xc, circle.yc, circle.R, circle.quarter, circle.color);
+        break;
+    }
+    DrawCircleOutline(rt, circle.algorithm, circle.xc, circle.yc, circle.R, circle.color);
+}
+
+inline void DrawEllipseShape(RenderTarget& rt, const Ellipsee& e) {
+    DrawEllipseOutline(rt, e.algorithm, e.xc, e.yc, e.a, e.b, e.color);
+}
+
+// Drawing never writes to the scene, so tiles may share it across threads;
+// a curve whose outline is not built yet is flattened on the fly instead.
+inline void DrawHermiteShape(RenderTarget& rt, const Scene& scene, int i) {
+    const HermiteTable& h = scene.hermites;
+    if (h.outlineTolerance[i] > 0) {
+        PointSpan outline = scene.Outline(h.outline[i]);
+        StrokePolyline(rt, outline.data, outline.count, h.color[i], CurvePenWidth);
+    }
+    else {
+        DrawHermiteCurve(rt, h.p0[i], h.p1[i], h.t0[i], h.t1[i], h.color[i]);
+    }
+}
+
+inline void DrawSplineShape(RenderTarget& rt, const Scene& scene, int i) {
+    const SplineTable& s = scene.splines;
+    if (s.outlineTolerance[i] > 0) {
+        PointSpan outline = scene.Outline(s.outline[i]);
+        StrokePolyline(rt, outline.data, outline.count, s.color[i], CurvePenWidth);
+    }
+    else {
+        PointSpan p = scene.Vertices(s.points[i]);
+        DrawCardinalSpline(rt, p.data, p.count, s.c[i], s.color[i]);
+    }
+}
+
+inline void DrawAdvancedShape(RenderTarget& rt, AdvancedKind kind, PointSpan points, COLORREF color) {
+    switch (kind) {
+    case ADVANCED_SQUARE_HERMITE:
+    case ADVANCED_EMPTY_SQUARE: {
+        if (points.count != 2) break;
+        int size = std::max(std::abs(points[1].x - points[0].x), std::abs(points[1].y - points[0].y));
+        Point topLeft(std::min(points[0].x, points[1].x), std::min(points[0].y, points[1].y));
+        if (kind == ADVANCED_SQUARE_HERMITE) {
+            FillSquareWithHermiteCurve(rt, topLeft, size, color);
+        }
+        else {
+            if (size <= 0) size = 1;
+            DrawEmptySquare(rt, topLeft, size, color);
+        }
+        break;
+    }
+    case ADVANCED_RECTANGLE_BEZIER: {
+        if (points.count != 2) break;
+        Point topLeft(std::min(points[0].x, points[1].x), std::min(points[0].y, points[1].y));
+        Point bottomRight(std::max(points[0].x, points[1].x), std::max(points[0].y, points[1].y));
+        FillRectangleWithBezierCurve(rt, topLeft, bottomRight, color);
+        break;
+    }
+    case ADVANCED_POLYGON_CONVEX:
+        if (points.count >= 3) ConvexFill(rt, points.data, points.count, color);
+        break;
+    case ADVANCED_POLYGON_NONCONVEX:
+        if (points.count >= 4) GeneralPolygonFill(rt, points.data, points.count, color);
+        break;
+    default:
+        break; // flood fills have a layer of their own (LayeredCanvas.h)
+    }
+}
+
+
+// Area a stored shape can touch when drawn; see the Bounds section of Raster.h.
+inline PixelRect AdvancedShapeBounds(AdvancedKind kind, PointSpan points) {
+    PixelRect none = { 0, 0, 0, 0 };
+    if (points.count < 2) return none;
+    switch (kind) {
+    case ADVANCED_SQUARE_HERMITE:
+    case ADVANCED_EMPTY_SQUARE: {
+        int size = std::max(std::abs(points[1].x - points[0].x), std::abs(points[1].y - points[0].y));
+        Point topLeft(std::min(points[0].x, points[1].x), std::min(points[0].y, points[1].y));
+        if (size <= 0) size = 1;
+        PixelRect r = PaddedBounds(topLeft.x, topLeft.y, topLeft.x + size, topLeft.y + size);
+        if (kind == ADVANCED_SQUARE_HERMITE) {
+            // the hatching curves bulge below the square
+            Point p0(topLeft.x, topLeft.y), p1(topLeft.x, topLeft.y + size);
+            Point t0(0, size / 4), t1(0, -size / 4);
+            PixelRect curves = HermiteBounds(p0, p1, t0, t1);
+            r = Union(r, curves);
+        }
+        return r;
+    }
+    case ADVANCED_RECTANGLE_BEZIER:
+        return PointsBounds(points.data, 2);
+    case ADVANCED_POLYGON_CONVEX:
+    case ADVANCED_POLYGON_NONCONVEX:
+        return PointsBounds(points.data, points.count);
+    default:
+        return none;
+    }
+}
+
+inline PixelRect ClipWindowBounds(const ClipWindow& w) {
+    return LineBounds(w.xmin, w.ymin, w.xmax, w.ymax);
+}
+
+
+inline int ShapeCount(const Scene& scene, ShapeKind kind) {
+    switch (kind) {
+    case SHAPE_LINES: return scene.lines.Size();
+    case SHAPE_POINTS: return scene.points.Size();
+    case SHAPE_CIRCLES: return scene.circles.Size();
+    case SHAPE_ELLIPSES: return scene.ellipses.Size();
+    case SHAPE_POLYGONS: return scene.polygons.Size();
+    case SHAPE_BEZIERS: return scene.beziers.Size();
+    case SHAPE_HERMITES: return scene.hermites.Size();
+    case SHAPE_SPLINES: return scene.splines.Size();
+    case SHAPE_ADVANCED: return scene.advanced.Size();
+    default: return 0;
+    }
+}
+
+inline PixelRect ShapeBounds(const Scene& scene, ShapeRef ref) {
+    int i = ref.index;
+    switch (ref.kind) {
+    case SHAPE_LINES: {
+        const LineArrays& e = scene.lines.ends;
+        return LineBounds(e.x1[i], e.y1[i], e.x2[i], e.y2[i]);
+    }
+    case SHAPE_POINTS:
+        return PaddedBounds(scene.points.x[i], scene.points.y[i], scene.points.x[i], scene.points.y[i]);
+    case SHAPE_CIRCLES:
+        return CircleBounds(scene.circles.xc[i], scene.circles.yc[i], scene.circles.R[i]);
+    case SHAPE_ELLIPSES: {
+        const EllipseTable& e = scene.ellipses;
+        return EllipseBounds(e.xc[i], e.yc[i], e.a[i], e.b[i]);
+    }
+    case SHAPE_POLYGONS: {
+        // clipped polygons only lose area, so the hull of the input is enough
+        PointSpan p = scene.Vertices(scene.polygons.points[i]);
+        return PointsBounds(p.data, p.count);
+    }
+    case SHAPE_BEZIERS: {
+        const BezierTable& b = scene.beziers;
+        Point hull[4] = { b.p0[i], b.p1[i], b.p2[i], b.p3[i] };
+        return PointsBounds(hull, 4);
+    }
+    case SHAPE_HERMITES: {
+        const HermiteTable& h = scene.hermites;
+        return HermiteBounds(h.p0[i], h.p1[i], h.t0[i], h.t1[i]);
+    }
+    case SHAPE_SPLINES: {
+        PointSpan p = scene.Vertices(scene.splines.points[i]);
+        return CardinalSplineBounds(p.data, p.count, scene.splines.c[i]);
+    }
+    case SHAPE_ADVANCED:
+        return AdvancedShapeBounds(scene.advanced.kind[i], scene.Vertices(scene.advanced.points[i]));
+    default: {
+        PixelRect none = { 0, 0, 0, 0 };
+        return none;
+    }
+    }
+}
+
+// Builds the outline of one shape if it has none or was flattened with
+// another tolerance; other kinds have none. Call after adding a curve,
+// before the scene is drawn from threads.
+inline void RefreshCurveOutline(Scene& scene, ShapeRef ref, double tolerance = DefaultCurveTolerance) {
+    static thread_local std::vector<Point> flat;
+    int i = ref.index;
+    PointRange* outline;
+    double* built;
+    flat.clear();
+    if (ref.kind == SHAPE_HERMITES) {
+        HermiteTable& h = scene.hermites;
+        if (h.outlineTolerance[i] == tolerance) return;
+        FlattenHermite(h.p0[i], h.p1[i], h.t0[i], h.t1[i], tolerance, flat);
+        outline = &h.outline[i];
+        built = &h.outlineTolerance[i];
+    }
+    else if (ref.kind == SHAPE_SPLINES) {
+        SplineTable& s = scene.splines;
+        if (s.outlineTolerance[i] == tolerance) return;
+        PointSpan p = scene.Vertices(s.points[i]);
+        FlattenCardinalSpline(p.data, p.count, s.c[i], tolerance, flat);
+        outline = &s.outline[i];
+        built = &s.outlineTolerance[i];
+    }
+    else {
+        return;
+    }
+    // flattened separately: FlattenHermite drops a first vertex that repeats
+    // the last one already in the pool
+    outline->first = (int)scene.outlines.size();
+    outline->count = (int)flat.size();
+    scene.outlines.insert(scene.outlines.end(), flat.begin(), flat.end());
+    *built = tolerance;
+}
+
+// Rebuilds every outline into a fresh pool, dropping the ones replaced
+// since the last rebuild.
+inline void RefreshCurveOutlines(Scene& scene, double tolerance = DefaultCurveTolerance) {
+    scene.outlines.clear();
+    std::fill(scene.hermites.outlineTolerance.begin(), scene.hermites.outlineTolerance.end(), 0.0);
+    std::fill(scene.splines.outlineTolerance.begin(), scene.splines.outlineTolerance.end(), 0.0);
+    for (int i = 0; i < scene.hermites.Size(); i++) RefreshCurveOutline(scene, HermiteHandle{ i }, tolerance);
+    for (int i = 0; i < scene.splines.Size(); i++) RefreshCurveOutline(scene, SplineHandle{ i }, tolerance);
+}
+
+// Draws one stored shape; w is the scene's ActiveClipWindow.
+inline void DrawShape(RenderTarget& rt, const Scene& scene, const ClipWindow& w, ShapeRef ref) {
+    int i = ref.index;
+    switch (ref.kind) {
+    case SHAPE_LINES: {
+        const LineTable& l = scene.lines;
+        Point p1(l.ends.x1[i], l.ends.y1[i]), p2(l.ends.x2[i], l.ends.y2[i]);
+        if (scene.currentClippingMethod == None || ClipLine(w, p1, p2))
+            DrawLineWith(rt, l.algorithm[i], p1.x, p1.y, p2.x, p2.y, l.color[i]);
+        break;
+    }
+    case SHAPE_POINTS:
+        clippingPoint(rt, w, scene.points.x[i], scene.points.y[i], RGB(255, 0, 0));
+        break;
+    case SHAPE_CIRCLES:
+        DrawCircleShape(rt, scene.circles[i]);
+        break;
+    case SHAPE_ELLIPSES:
+        DrawEllipseShape(rt, scene.ellipses[i]);
+        break;
+    case SHAPE_POLYGONS: {
+        const PolygonTable& p = scene.polygons;
+        PointSpan v = scene.Vertices(p.points[i]);
+        PolygonClip(rt, v.data, v.count, p.xl[i], p.xr[i], p.yt[i], p.yb[i], p.color[i]);
+        break;
+    }
+    case SHAPE_BEZIERS: {
+        const BezierTable& b = scene.beziers;
+        DrawBezierCurve(rt, b.p0[i], b.c0[i], b.p1[i], b.c1[i], b.p2[i], b.c2[i], b.p3[i], b.c3[i]);
+        break;
+    }
+    case SHAPE_HERMITES:
+        DrawHermiteShape(rt, scene, i);
+        break;
+    case SHAPE_SPLINES:
+        DrawSplineShape(rt, scene, i);
+        break;
+    case SHAPE_ADVANCED:
+        DrawAdvancedShape(rt, scene.advanced.kind[i], scene.Vertices(scene.advanced.points[i]), scene.advanced.color[i]);
+        break;
+    default:
+        break;
+    }
+}
+
+// Red outline of the active clipping window, painted beneath every shape.
+inline void DrawClipOutline(RenderTarget& rt, const Scene& scene, const ClipWindow& w) {
+    if ((scene.currentClippingMethod == RECTANGLE && scene.clippingEnabled && scene.clippingRectDrawn) ||
+        (scene.currentClippingMethod == SQUARE && scene.clippingEnabledSquare && scene.clippingSquareDrawn)) {
+        if (Intersects(ClipWindowBounds(w), rt.clip))
+            DrawClippingRectangle(rt, w);
+    }
+}
+
+// Lines drawn without a clip window, as one DrawLines batch. refs must all
+// be SHAPE_LINES.
+inline void DrawUnclippedLines(RenderTarget& rt, const Scene& scene, const ShapeRef* refs, size_t n) {
+    static thread_local std::vector<int> style;
+    static thread_local LineArrays batch;
+    const LineTable& lines = scene.lines;
+    bool all = n == (size_t)lines.Size();
+    if (!all) {
+        style.clear();
+        batch.Clear();
+        for (size_t i = 0; i < n; i++) {
+            int k = refs[i].index;
+            style.push_back(k);
+            batch.Push(lines.ends.x1[k], lines.ends.y1[k], lines.ends.x2[k], lines.ends.y2[k]);
+        }
+    }
+    const LineArrays& e = all ? lines.ends : batch;
+    LineBatch b = { e.x1.data(), e.y1.data(), e.x2.data(), e.y2.data(), lines.algorithm.data(), lines.color.data(),
+        all ? nullptr : style.data(), n };
+    DrawLines(rt, b);
+}
+
+// Lines drawn under a clip window are clipped together in one ClipLines
+// pass, then drawn in order as one DrawLines batch. refs must all be
+// SHAPE_LINES.
+inline void DrawClippedLines(RenderTarget& rt, const Scene& scene, const ClipWindow& w, const ShapeRef* refs, size_t n) {
+    static thread_local LineArrays batch;
+    static thread_local ClippedLines clipped;
+    static thread_local std::vector<int> style;
+    const LineTable& lines = scene.lines;
+    // refs are sorted and distinct, so when there are as many as lines they
+    // are all of them, and the end point columns are clipped in place
+    bool all = n == (size_t)lines.Size();
+    if (!all) {
+        batch.Clear();
+        for (size_t i = 0; i < n; i++) {
+            int k = refs[i].index;
+            batch.Push(lines.ends.x1[k], lines.ends.y1[k], lines.ends.x2[k], lines.ends.y2[k]);
+        }
+    }
+    ClipLines(w, all ? lines.ends : batch, clipped);
+    style.clear();
+    for (size_t i = 0; i < clipped.Size(); i++) style.push_back(refs[clipped.source[i]].index);
+    const LineArrays& c = clipped.lines;
+    LineBatch b = { c.x1.data(), c.y1.data(), c.x2.data(), c.y2.data(), lines.algorithm.data(), lines.color.data(),
+        style.data(), clipped.Size() };
+    DrawLines(rt, b);
+}
+
+// Draws refs[0, n), which must be in painting order. Lines come first in
+// that order, so they form a leading run drawn as one batch, clipped
+// together first under a clip window.
+inline void DrawShapeList(RenderTarget& rt, const Scene& scene, const ClipWindow& w, const ShapeRef* refs, size_t n) {
+    size_t lines = 0;
+    while (lines < n && refs[lines].kind == SHAPE_LINES) lines++;
+    if (scene.currentClippingMethod != None) DrawClippedLines(rt, scene, w, refs, lines);
+    else DrawUnclippedLines(rt, scene, refs, lines);
+    for (size_t i = lines; i < n; i++)
+        DrawShape(rt, scene, w, refs[i]);
+}
+
+// Redraws the scene inside rt.clip; shapes whose bounds miss it are skipped,
+// so repainting a small damaged area costs little more than the shapes in it.
+inline void DrawAllShapes(RenderTarget& rt, const Scene& scene) {
+    static thread_local std::vector<ShapeRef> refs;
+    refs.clear();
+    for (int k = 0; k < SHAPE_KIND_COUNT; k++) {
+        int n = ShapeCount(scene, (ShapeKind)k);
+        for (int i = 0; i < n; i++) {
+            ShapeRef ref = { (ShapeKind)k, i };
+            if (Intersects(ShapeBounds(scene, ref), rt.clip))
+                refs.push_back(ref);
+        }
+    }
+    ClipWindow w = ActiveClipWindow(scene);
+    DrawClipOutline(rt, scene, w);
+    DrawShapeList(rt, scene, w, refs.data(), refs.size());
+}
+
+// Same as DrawAllShapes for a precomputed candidate list, which must be in
+// painting order (sorted) — typically a SceneIndex query for rt.clip.
+inline void DrawShapes(RenderTarget& rt, const Scene& scene, const std::vector<ShapeRef>& refs) {
+    ClipWindow w = ActiveClipWindow(scene);
+    DrawClipOutline(rt, scene, w);
+    DrawShapeList(rt, scene, w, refs.data(), refs.size());
+}
@@ -0,0 +1,513 @@
+#pragma once
+
+// Binary scene file (shapes.bin).
+//
+// Everything is little-endian:
+//
+//   SceneFileHeader
+//   SceneFileSection[sectionCount]   kind, record size, record count, offset
+//   section payloads, 8-byte aligned, each an array of fixed-size records
+//
+// Polygons, splines and advanced shapes keep their vertices in the shared
+// SECTION_POINT_POOL and refer to them by (firstPoint, pointCount), just as
+// the Scene does; advanced shape types are indices into SECTION_TYPE_NAMES,
+// and a name this version has no AdvancedKind for fails the load. Readers skip unknown
+// sections and step through records by the stored recordSize, so a later
+// version may append fields to a record without breaking older readers.
+// Advanced records gained the flood fill boundary colour that way; records
+// without it load with CLR_INVALID there.
+//
+// The loader maps the file and copies records straight into the Scene's
+// columns and vertex pool; no field is parsed.
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Scene.h"
+#include "MappedFile.h"
+#include "SceneIo.h"
+
+const uint32_t SceneFileVersion = 1;
+static const char SceneFileMagic[8] = { 'G', 'P', 'S', 'C', 'E', 'N', 'E', 0 };
+
+enum SceneFileSectionKind {
+    SECTION_LINES = 1,
+    SECTION_POINTS,
+    SECTION_CIRCLES,
+    SECTION_ELLIPSES,
+    SECTION_POLYGONS,
+    SECTION_BEZIERS,
+    SECTION_HERMITES,
+    SECTION_SPLINES,
+    SECTION_ADVANCED,
+    SECTION_POINT_POOL,
+    SECTION_TYPE_NAMES,
+    SECTION_CLIPPING
+};
+
+struct SceneFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint64_t fileSize;
+};
+
+struct SceneFileSection {
+    uint32_t kind;
+    uint32_t recordSize;
+    uint64_t count;
+    uint64_t offset;
+};
+
+struct PointRecord { int32_t x, y; };
+struct LineRecord { int32_t x1, y1, x2, y2; uint32_t color; int32_t algorithm; };
+struct CircleRecord { int32_t xc, yc, R; uint32_t color; int32_t quarter, algorithm; };
+struct EllipseRecord { int32_t xc, yc, a, b; uint32_t color; int32_t quarter, algorithm; };
+struct PolygonRecord { uint32_t firstPoint, pointCount; int32_t xl, xr, yb, yt; uint32_t color; };
+struct BezierRecord { PointRecord p[4]; uint32_t c[4]; };
+struct HermiteRecord { PointRecord p0, p1, t0, t1; uint32_t color; };
+struct SplineRecord { uint32_t firstPoint, pointCount; int32_t n; uint32_t color; double c; };
+struct AdvancedRecord { uint32_t type, firstPoint, pointCount, color, boundary; };
+struct TypeNameRecord { char name[32]; };
+
+enum ClippingFlags {
+    CLIP_RECT_ENABLED = 1,
+    CLIP_SQUARE_ENABLED = 2,
+    CLIP_RECT_DRAWN = 4,
+    CLIP_SQUARE_DRAWN = 8
+};
+
+struct ClippingRecord {
+    int32_t method;
+    int32_t rect[4];   // left, top, right, bottom
+    int32_t square[4];
+    uint32_t flags;    // ClippingFlags
+};
+
+static_assert(sizeof(SceneFileHeader) == 24 && sizeof(SceneFileSection) == 24, "scene file header layout");
+static_assert(sizeof(LineRecord) == 24 && sizeof(SplineRecord) == 24 && sizeof(BezierRecord) == 48, "scene file record layout");
+
+
+inline bool IsLittleEndianHost() {
+    const uint32_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+inline PointRecord ToRecord(const Point& p) {
+    PointRecord r = { p.x, p.y };
+    return r;
+}
+
+inline Point FromRecord(const PointRecord& r) {
+    return Point(r.x, r.y);
+}
+
+
+// Collects the scene into record arrays, then writes them in one pass.
+class SceneFileWriter {
+public:
+    bool Write(const Scene& scene, const char* path, std::string* error, SceneIoProgress* progress = nullptr) {
+        if (!IsLittleEndianHost()) return Fail(error, "binary scenes need a little-endian host");
+        Build(scene);
+        if (pool.size() > UINT32_MAX) return Fail(error, "too many vertices for a version 1 scene file");
+
+        const std::string temp = TempPathFor(path);
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return Fail(error, "cannot create " + temp);
+
+        std::vector<SceneFileSection> table;
+        uint64_t offset = sizeof(SceneFileHeader) + sizeof(SceneFileSection) * 12;
+        AddSection(table, offset, SECTION_LINES, lines);
+        AddSection(table, offset, SECTION_POINTS, points);
+        AddSection(table, offset, SECTION_CIRCLES, circles);
+        AddSection(table, offset, SECTION_ELLIPSES, ellipses);
+        AddSection(table, offset, SECTION_POLYGONS, polygons);
+        AddSection(table, offset, SECTION_BEZIERS, beziers);
+        AddSection(table, offset, SECTION_HERMITES, hermites);
+        AddSection(table, offset, SECTION_SPLINES, splines);
+        AddSection(table, offset, SECTION_ADVANCED, advanced);
+        AddSection(table, offset, SECTION_POINT_POOL, pool);
+        AddSection(table, offset, SECTION_TYPE_NAMES, typeNames);
+        AddSection(table, offset, SECTION_CLIPPING, clipping);
+
+        SceneFileHeader header;
+        std::memcpy(header.magic, SceneFileMagic, sizeof(header.magic));
+        header.version = SceneFileVersion;
+        header.sectionCount = (uint32_t)table.size();
+        header.fileSize = offset;
+
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)table.data(), sizeof(SceneFileSection) * table.size());
+        out = &file;
+        written = sizeof(header) + sizeof(SceneFileSection) * table.size();
+        total = offset;
+        this->progress = progress;
+        bool complete = WritePayload(lines) && WritePayload(points) && WritePayload(circles) &&
+            WritePayload(ellipses) && WritePayload(polygons) && WritePayload(beziers) &&
+            WritePayload(hermites) && WritePayload(splines) && WritePayload(advanced) &&
+            WritePayload(pool) && WritePayload(typeNames) && WritePayload(clipping);
+
+        file.close();
+        if (!complete || !file || !ReplaceWithTemp(temp, path)) {
+            std::remove(temp.c_str());
+            return Fail(error, !complete ? std::string("cancelled") : std::string("error writing ") + path);
+        }
+        return true;
+    }
+
+private:
+    void Build(const Scene& scene) {
+        lines.clear(); points.clear(); circles.clear(); ellipses.clear(); polygons.clear();
+        beziers.clear(); hermites.clear(); splines.clear(); advanced.clear(); pool.clear();
+        typeNames.clear(); clipping.clear();
+
+        const LineTable& l = scene.lines;
+        lines.reserve(l.Size());
+        for (int i = 0; i < l.Size(); i++) {
+            LineRecord r = { l.ends.x1[i], l.ends.y1[i], l.ends.x2[i], l.ends.y2[i], (uint32_t)l.color[i], l.algorithm[i] };
+            lines.push_back(r);
+        }
+        points.reserve(scene.points.Size());
+        for (int i = 0; i < scene.points.Size(); i++) points.push_back(ToRecord(scene.points[i]));
+        const CircleTable& c = scene.circles;
+        circles.reserve(c.Size());
+        for (int i = 0; i < c.Size(); i++) {
+            CircleRecord r = { c.xc[i], c.yc[i], c.R[i], (uint32_t)c.color[i], c.quarter[i], c.algorithm[i] };
+            circles.push_back(r);
+        }
+        const EllipseTable& e = scene.ellipses;
+        ellipses.reserve(e.Size());
+        for (int i = 0; i < e.Size(); i++) {
+            EllipseRecord r = { e.xc[i], e.yc[i], e.a[i], e.b[i], (uint32_t)e.color[i], e.quarter[i], e.algorithm[i] };
+            ellipses.push_back(r);
+        }
+        const PolygonTable& p = scene.polygons;
+        polygons.reserve(p.Size());
+        for (int i = 0; i < p.Size(); i++) {
+            PolygonRecord r = { (uint32_t)p.points[i].first, (uint32_t)p.points[i].count, p.xl[i], p.xr[i], p.yb[i], p.yt[i], (uint32_t)p.color[i] };
+            polygons.push_back(r);
+        }
+        const BezierTable& b = scene.beziers;
+        beziers.reserve(b.Size());
+        for (int i = 0; i < b.Size(); i++) {
+            BezierRecord r = { { ToRecord(b.p0[i]), ToRecord(b.p1[i]), ToRecord(b.p2[i]), ToRecord(b.p3[i]) },
+                { (uint32_t)b.c0[i], (uint32_t)b.c1[i], (uint32_t)b.c2[i], (uint32_t)b.c3[i] } };
+            beziers.push_back(r);
+        }
+        const HermiteTable& h = scene.hermites;
+        hermites.reserve(h.Size());
+        for (int i = 0; i < h.Size(); i++) {
+            HermiteRecord r = { ToRecord(h.p0[i]), ToRecord(h.p1[i]), ToRecord(h.t0[i]), ToRecord(h.t1[i]), (uint32_t)h.color[i] };
+            hermites.push_back(r);
+        }
+        const SplineTable& s = scene.splines;
+        splines.reserve(s.Size());
+        for (int i = 0; i < s.Size(); i++) {
+            SplineRecord r = { (uint32_t)s.points[i].first, (uint32_t)s.points[i].count, s.points[i].count, (uint32_t)s.color[i], s.c[i] };
+            splines.push_back(r);
+        }
+        const AdvancedTable& a = scene.advanced;
+        advanced.reserve(a.Size());
+        for (int i = 0; i < a.Size(); i++) {
+            AdvancedRecord r = { (uint32_t)a.kind[i], (uint32_t)a.points[i].first, (uint32_t)a.points[i].count, (uint32_t)a.color[i],
+                (uint32_t)a.boundary[i] };
+            advanced.push_back(r);
+        }
+        // the scene's vertex pool is written as it is, so the ranges above
+        // index it unchanged
+        pool.reserve(scene.vertices.size());
+        for (const Point& v : scene.vertices) pool.push_back(ToRecord(v));
+        for (const char* name : AdvancedKindNames) {
+            TypeNameRecord r = {};
+            std::strncpy(r.name, name, sizeof(r.name) - 1);
+            typeNames.push_back(r);
+        }
+
+        ClippingRecord clip = {};
+        clip.method = scene.currentClippingMethod;
+        clip.rect[0] = scene.clippingRect.left; clip.rect[1] = scene.clippingRect.top;
+        clip.rect[2] = scene.clippingRect.right; clip.rect[3] = scene.clippingRect.bottom;
+        clip.square[0] = scene.clippingSquare.left; clip.square[1] = scene.clippingSquare.top;
+        clip.square[2] = scene.clippingSquare.right; clip.square[3] = scene.clippingSquare.bottom;
+        clip.flags = (scene.clippingEnabled ? CLIP_RECT_ENABLED : 0) | (scene.clippingEnabledSquare ? CLIP_SQUARE_ENABLED : 0) |
+            (scene.clippingRectDrawn ? CLIP_RECT_DRAWN : 0) | (scene.clippingSquareDrawn ? CLIP_SQUARE_DRAWN : 0);
+        clipping.push_back(clip);
+    }
+
+    static uint64_t Align8(uint64_t v) { return (v + 7) & ~(uint64_t)7; }
+
+    template <class T>
+    static void AddSection(std::vector<SceneFileSection>& table, uint64_t& offset, uint32_t kind, const std::vector<T>& records) {
+        offset = Align8(offset);
+        SceneFileSection s = { kind, (uint32_t)sizeof(T), records.size(), offset };
+        table.push_back(s);
+        offset += sizeof(T) * records.size();
+    }
+
+    // Writes in 1 MB pieces so progress moves and a cancel is noticed
+    // within one piece.
+    template <class T>
+    bool WritePayload(const std::vector<T>& records) {
+        static const char zeros[8] = {};
+        static const uint64_t Piece = 1 << 20;
+        uint64_t aligned = Align8(written);
+        out->write(zeros, (std::streamsize)(aligned - written));
+        written = aligned;
+        const char* bytes = (const char*)records.data();
+        uint64_t left = sizeof(T) * records.size();
+        while (left > 0) {
+            uint64_t n = std::min(left, Piece);
+            out->write(bytes, (std::streamsize)n);
+            bytes += n;
+            left -= n;
+            written += n;
+            if (progress && !progress->Update(written, total)) return false;
+        }
+        return true;
+    }
+
+    static bool Fail(std::string* error, const std::string& message) {
+        if (error) *error = message;
+        return false;
+    }
+
+    std::vector<LineRecord> lines;
+    std::vector<PointRecord> points;
+    std::vector<CircleRecord> circles;
+    std::vector<EllipseRecord> ellipses;
+    std::vector<PolygonRecord> polygons;
+    std::vector<BezierRecord> beziers;
+    std::vector<HermiteRecord> hermites;
+    std::vector<SplineRecord> splines;
+    std::vector<AdvancedRecord> advanced;
+    std::vector<PointRecord> pool;
+    std::vector<TypeNameRecord> typeNames;
+    std::vector<ClippingRecord> clipping;
+
+    std::ofstream* out = nullptr;
+    uint64_t written = 0, total = 0;
+    SceneIoProgress* progress = nullptr;
+};
+
+inline bool SaveSceneBinary(const Scene& scene, const char* path, std::string* error = nullptr, SceneIoProgress* progress = nullptr) {
+    SceneFileWriter writer;
+    return writer.Write(scene, path, error, progress);
+}
+
+
+// Validating reader over an in-memory image of the file. On failure the
+// destination scene is left untouched.
+class SceneFileReader {
+public:
+    SceneFileReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+
+    bool Read(Scene& out, std::string* error, SceneIoProgress* progress = nullptr) {
+        this->progress = progress;
+        if (!IsLittleEndianHost()) return Fail(error, "binary scenes need a little-endian host");
+        SceneFileHeader header;
+        if (size < sizeof(header)) return Fail(error, "file too short for a scene header");
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, SceneFileMagic, sizeof(header.magic)) != 0) return Fail(error, "not a binary scene file");
+        if (header.version == 0 || header.version > SceneFileVersion)
+            return Fail(error, "unsupported scene file version " + std::to_string(header.version));
+        if ((uint64_t)header.sectionCount * sizeof(SceneFileSection) > size - sizeof(header))
+            return Fail(error, "section table runs past the end of the file");
+
+        for (uint32_t i = 0; i < header.sectionCount; i++) {
+            SceneFileSection s;
+            std::memcpy(&s, data + sizeof(header) + i * sizeof(SceneFileSection), sizeof(s));
+            if (s.offset > size || (s.recordSize && s.count > (size - s.offset) / s.recordSize))
+                return Fail(error, "section " + std::to_string(s.kind) + " runs past the end of the file");
+            if (s.kind < SECTION_LINES || s.kind > SECTION_CLIPPING) continue; // newer section
+            if (s.recordSize < MinRecordSize(s.kind))
+                return Fail(error, "section " + std::to_string(s.kind) + " has records that are too small");
+            sections[s.kind] = s;
+            if (s.kind != SECTION_POINT_POOL && s.kind != SECTION_TYPE_NAMES) totalRecords += s.count;
+        }
+
+        Scene scene;
+        if (!ReadTypeNames(error)) return false;
+        const SceneFileSection* poolSection = Find(SECTION_POINT_POOL);
+        poolCount = poolSection ? poolSection->count : 0;
+
+        bool ok = ReadPool(scene);
+        ok = ok && ReadAll<LineRecord>(SECTION_LINES, scene.lines, [&](const LineRecord& r) {
+            Line l = { r.x1, r.y1, r.x2, r.y2, r.color, r.algorithm };
+            scene.lines.Push(l);
+            return true;
+        });
+        ok = ok && ReadAll<PointRecord>(SECTION_POINTS, scene.points, [&](const PointRecord& r) {
+            scene.points.Push(FromRecord(r));
+            return true;
+        });
+        ok = ok && ReadAll<CircleRecord>(SECTION_CIRCLES, scene.circles, [&](const CircleRecord& r) {
+            Circle c = { r.xc, r.yc, r.R, r.color, r.quarter, r.algorithm };
+            scene.circles.Push(c);
+            return true;
+        });
+        ok = ok && ReadAll<EllipseRecord>(SECTION_ELLIPSES, scene.ellipses, [&](const EllipseRecord& r) {
+            Ellipsee e = { r.xc, r.yc, r.a, r.b, r.color, r.quarter, r.algorithm };
+            scene.ellipses.Push(e);
+            return true;
+        });
+        ok = ok && ReadAll<PolygonRecord>(SECTION_POLYGONS, scene.polygons, [&](const PolygonRecord& r) {
+            PointRange range;
+            if (!Range(r.firstPoint, r.pointCount, range)) return false;
+            scene.polygons.Push(range, r.xl, r.xr, r.yt, r.yb, r.color);
+            return true;
+        });
+        ok = ok && ReadAll<BezierRecord>(SECTION_BEZIERS, scene.beziers, [&](const BezierRecord& r) {
+            BezierCurve b = { FromRecord(r.p[0]), FromRecord(r.p[1]), FromRecord(r.p[2]), FromRecord(r.p[3]),
+                r.c[0], r.c[1], r.c[2], r.c[3] };
+            scene.beziers.Push(b);
+            return true;
+        });
+        ok = ok && ReadAll<HermiteRecord>(SECTION_HERMITES, scene.hermites, [&](const HermiteRecord& r) {
+            HermiteCurve h = { FromRecord(r.p0), FromRecord(r.p1), FromRecord(r.t0), FromRecord(r.t1), r.color };
+            scene.hermites.Push(h);
+            return true;
+        });
+        // a spline runs through the first n of its points
+        ok = ok && ReadAll<SplineRecord>(SECTION_SPLINES, scene.splines, [&](const SplineRecord& r) {
+            PointRange range;
+            if (!Range(r.firstPoint, r.pointCount, range) || r.n < 0 || r.n > range.count) return false;
+            range.count = r.n;
+            scene.splines.Push(range, r.c, r.color);
+            return true;
+        });
+        const SceneFileSection* advancedSection = Find(SECTION_ADVANCED);
+        bool boundaries = advancedSection && advancedSection->recordSize >= sizeof(AdvancedRecord);
+        ok = ok && ReadAll<AdvancedRecord>(SECTION_ADVANCED, scene.advanced, [&](const AdvancedRecord& r) {
+            PointRange range;
+            if (r.type >= typeKinds.size() || typeKinds[r.type] < 0 || !Range(r.firstPoint, r.pointCount, range)) return false;
+            scene.advanced.Push((AdvancedKind)typeKinds[r.type], range, r.color, boundaries ? r.boundary : CLR_INVALID);
+            return true;
+        });
+        if (!ok && progress && progress->Cancelled()) return Fail(error, "cancelled");
+        if (!ok) return Fail(error, "a shape refers to vertices that are not in the file or to an unknown type");
+
+        if (const SceneFileSection* s = Find(SECTION_CLIPPING)) {
+            if (s->count > 0) {
+                ClippingRecord c;
+                std::memcpy(&c, data + s->offset, sizeof(c));
+                scene.currentClippingMethod = (ClippingMethod)c.method;
+                scene.clippingRect = { c.rect[0], c.rect[1], c.rect[2], c.rect[3] };
+                scene.clippingSquare = { c.square[0], c.square[1], c.square[2], c.square[3] };
+                scene.clippingEnabled = (c.flags & CLIP_RECT_ENABLED) != 0;
+                scene.clippingEnabledSquare = (c.flags & CLIP_SQUARE_ENABLED) != 0;
+                scene.clippingRectDrawn = (c.flags & CLIP_RECT_DRAWN) != 0;
+                scene.clippingSquareDrawn = (c.flags & CLIP_SQUARE_DRAWN) != 0;
+            }
+        }
+
+        out = std::move(scene);
+        return true;
+    }
+
+private:
+    static uint32_t MinRecordSize(uint32_t kind) {
+        switch (kind) {
+        case SECTION_LINES: return sizeof(LineRecord);
+        case SECTION_POINTS: return sizeof(PointRecord);
+        case SECTION_CIRCLES: return sizeof(CircleRecord);
+        case SECTION_ELLIPSES: return sizeof(EllipseRecord);
+        case SECTION_POLYGONS: return sizeof(PolygonRecord);
+        case SECTION_BEZIERS: return sizeof(BezierRecord);
+        case SECTION_HERMITES: return sizeof(HermiteRecord);
+        case SECTION_SPLINES: return sizeof(SplineRecord);
+        case SECTION_ADVANCED: return offsetof(AdvancedRecord, boundary);
+        case SECTION_POINT_POOL: return sizeof(PointRecord);
+        case SECTION_TYPE_NAMES: return sizeof(TypeNameRecord);
+        case SECTION_CLIPPING: return sizeof(ClippingRecord);
+        default: return 0;
+        }
+    }
+
+    const SceneFileSection* Find(uint32_t kind) const {
+        return sections[kind].recordSize ? &sections[kind] : nullptr;
+    }
+
+    // Maps each stored type name to its AdvancedKind, or -1 if unknown.
+    bool ReadTypeNames(std::string* error) {
+        typeKinds.clear();
+        const SceneFileSection* s = Find(SECTION_TYPE_NAMES);
+        if (!s) return true;
+        for (uint64_t i = 0; i < s->count; i++) {
+            const char* name = (const char*)data + s->offset + i * s->recordSize;
+            size_t len = 0;
+            while (len < sizeof(TypeNameRecord::name) && name[len]) len++;
+            if (len == sizeof(TypeNameRecord::name)) return Fail(error, "unterminated shape type name");
+            AdvancedKind kind;
+            typeKinds.push_back(AdvancedKindFromName(name, len, kind) ? (int)kind : -1);
+        }
+        return true;
+    }
+
+    // Copies the whole point pool into the scene's, so stored ranges keep
+    // their meaning.
+    bool ReadPool(Scene& scene) {
+        const SceneFileSection* s = Find(SECTION_POINT_POOL);
+        if (!s) return true;
+        if (poolCount > (uint64_t)INT_MAX) return false;
+        scene.vertices.resize((size_t)poolCount);
+        const unsigned char* p = data + s->offset;
+        for (uint64_t i = 0; i < poolCount; i++, p += s->recordSize) {
+            PointRecord r;
+            std::memcpy(&r, p, sizeof(r));
+            scene.vertices[i] = FromRecord(r);
+        }
+        return true;
+    }
+
+    bool Range(uint32_t first, uint32_t count, PointRange& range) const {
+        if ((uint64_t)first + count > poolCount) return false;
+        range.first = (int)first;
+        range.count = (int)count;
+        return true;
+    }
+
+    template <class R, class Table, class F>
+    bool ReadAll(uint32_t kind, Table& table, F add) {
+        const SceneFileSection* s = Find(kind);
+        if (!s) return true;
+        table.Reserve((size_t)s->count);
+        const unsigned char* p = data + s->offset;
+        for (uint64_t i = 0; i < s->count; i++, p += s->recordSize) {
+            // an older record may stop short of the fields added since
+            R r = R();
+            std::memcpy(&r, p, std::min<size_t>(sizeof(r), s->recordSize));
+            if (!add(r)) return false;
+            if ((i & 0xFFFF) == 0xFFFF && progress && !progress->Update(recordsDone + i, totalRecords)) return false;
+        }
+        recordsDone += s->count;
+        return true;
+    }
+
+    static bool Fail(std::string* error, const std::string& message) {
+        if (error) *error = message;
+        return false;
+    }
+
+    const unsigned char* data;
+    size_t size;
+    SceneFileSection sections[SECTION_CLIPPING + 1] = {};
+    std::vector<int> typeKinds;
+    uint64_t poolCount = 0;
+    uint64_t totalRecords = 0, recordsDone = 0;
+    SceneIoProgress* progress = nullptr;
+};
+
+inline bool LoadSceneBinary(const char* path, Scene& out, std::string* error = nullptr, SceneIoProgress* progress = nullptr) {
+    MappedFile file;
+    if (!file.Open(path, error)) return false;
+    SceneFileReader reader(file.Data(), file.Size());
+    return reader.Read(out, error, progress);
+}
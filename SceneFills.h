@@ -0,0 +1,87 @@
+#pragma once
+
+// Flood fills of a Scene, traced and painted the way the window shows them.
+//
+// A fill is stored as its seed, colour and boundary colour. It is traced on
+// the other shapes alone: no other fill, point or clip outline shapes it.
+// The runs found are painted beneath those shapes. LayeredCanvas keeps the
+// runs and traces a fill again only when the geometry around it changes.
+// DrawFloodFills traces every fill once for a single frame.
+
+#include <vector>
+#include <algorithm>
+#include "Scene.h"
+#include "FloodFill.h"
+
+// True when advanced shape i is a flood fill with a boundary to stop at.
+inline bool IsActiveFloodFill(const Scene& scene, int i) {
+    const AdvancedTable& advanced = scene.advanced;
+    return IsFloodFill(advanced.kind[i]) && advanced.boundary[i] != CLR_INVALID && advanced.points[i].count >= 1;
+}
+
+// Traces fill i of the advanced table on geometry and leaves its runs in
+// runs, sorted by row. Returns false, with no runs, when i paints nothing or
+// the trace overflowed (tracer.Overflowed() tells which).
+inline bool TraceSceneFill(ScanlineFloodFill& tracer, const RenderTarget& geometry, const Scene& scene, int i,
+    std::vector<FloodRun>& runs) {
+    runs.clear();
+    if (!IsActiveFloodFill(scene, i)) return false;
+    const AdvancedTable& advanced = scene.advanced;
+    Point seed = scene.Vertices(advanced.points[i])[0];
+    tracer.Trace(geometry, seed.x, seed.y, advanced.color[i], advanced.boundary[i], runs);
+    if (tracer.Overflowed()) {
+        runs.clear();
+        return false;
+    }
+    std::sort(runs.begin(), runs.end(), [](const FloodRun& a, const FloodRun& b) {
+        return a.y != b.y ? a.y < b.y : a.x1 < b.x1;
+    });
+    return true;
+}
+
+// Paints the runs TraceSceneFill found inside rt.clip.
+inline void PaintFloodRuns(RenderTarget& rt, const std::vector<FloodRun>& runs, uint32_t pixel) {
+    const PixelRect& c = rt.clip;
+    auto it = std::lower_bound(runs.begin(), runs.end(), c.top, [](const FloodRun& run, int y) {
+        return run.y < y;
+    });
+    for (; it != runs.end() && it->y < c.bottom; ++it) {
+        int x1 = std::max(it->x1, c.left), x2 = std::min(it->x2 + 1, c.right);
+        if (x1 < x2) FillPixels(PixelAt(rt, x1, it->y), (size_t)(x2 - x1), pixel);
+    }
+}
+
+// Paints every flood fill of the scene on rt, in the order they were added.
+// The shapes are drawn afterwards, with DrawAllShapes, so they lie over the
+// fills. Each fill is traced on the shapes drawn over all of rt, whatever
+// its clip, and a trace that overflows paints nothing.
+inline void DrawFloodFills(RenderTarget& rt, const Scene& scene) {
+    const AdvancedTable& advanced = scene.advanced;
+    int first = 0;
+    while (first < advanced.Size() && !IsActiveFloodFill(scene, first)) first++;
+    if (first == advanced.Size()) return;
+
+    static thread_local PixelBuffer layer;
+    static thread_local std::vector<ShapeRef> refs;
+    static thread_local std::vector<FloodRun> runs;
+    static thread_local ScanlineFloodFill tracer;
+    layer.Resize(rt.width, rt.height);
+    std::fill(layer.pixels.begin(), layer.pixels.end(), TransparentPixel);
+    RenderTarget geometry = layer.Target();
+    geometry.left = rt.left;
+    geometry.top = rt.top;
+    geometry.clip = PixelRect{ rt.left, rt.top, rt.left + rt.width, rt.top + rt.height };
+
+    refs.clear();
+    for (int k = 0; k < SHAPE_KIND_COUNT; k++) {
+        if (k == SHAPE_POINTS) continue;
+        for (int i = 0; i < ShapeCount(scene, (ShapeKind)k); i++) {
+            ShapeRef ref = { (ShapeKind)k, i };
+            if (Intersects(ShapeBounds(scene, ref), geometry.clip)) refs.push_back(ref);
+        }
+    }
+    DrawShapeList(geometry, scene, ActiveClipWindow(scene), refs.data(), refs.size());
+
+    for (int i = first; i < advanced.Size(); i++)
+        if (TraceSceneFill(tracer, geometry, scene, i, runs)) PaintFloodRuns(rt, runs, ToPixel(advanced.color[i]));
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+// Sparse uniform grid over the bounding boxes of a Scene's shapes.
+//
+// Every shape is registered in each cell its ShapeBounds overlaps, so a
+// rectangle or point query only visits the cells it touches instead of the
+// whole scene. Shapes spanning more than maxCellsPerShape cells go to a
+// short list checked on every query, which keeps a few huge circles from
+// flooding the grid. Cells live in a hash map, so shapes drawn far off
+// screen or at negative coordinates need no special casing.
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "Scene.h"
+
+class SceneIndex {
+public:
+    explicit SceneIndex(int cellSize = 64, int maxCellsPerShape = 1024)
+        : cellSize(cellSize), maxCellsPerShape(maxCellsPerShape), count(0) {}
+
+    void Clear() {
+        cells.clear();
+        large.clear();
+        for (auto& b : bounds) b.clear();
+        count = 0;
+    }
+
+    // Re-indexes every shape; used after a load or a bulk edit.
+    void Rebuild(const Scene& scene) {
+        Clear();
+        for (int k = 0; k < SHAPE_KIND_COUNT; k++) {
+            int n = ShapeCount(scene, (ShapeKind)k);
+            for (int i = 0; i < n; i++) {
+                ShapeRef ref = { (ShapeKind)k, i };
+                Insert(ref, ShapeBounds(scene, ref));
+            }
+        }
+    }
+
+    // Registers a shape; empty bounds (flood fill records) are remembered
+    // but never returned by a query.
+    void Insert(ShapeRef ref, const PixelRect& r) {
+        std::vector<PixelRect>& kindBounds = bounds[ref.kind];
+        if ((int)kindBounds.size() <= ref.index) {
+            PixelRect none = { 0, 0, 0, 0 };
+            kindBounds.resize(ref.index + 1, none);
+        }
+        kindBounds[ref.index] = r;
+        count++;
+        if (IsEmpty(r)) return;
+
+        int cx1 = CellOf(r.left), cy1 = CellOf(r.top);
+        int cx2 = CellOf(r.right - 1), cy2 = CellOf(r.bottom - 1);
+        if ((long long)(cx2 - cx1 + 1) * (cy2 - cy1 + 1) > maxCellsPerShape) {
+            large.push_back(ref);
+            return;
+        }
+        for (int cy = cy1; cy <= cy2; cy++)
+            for (int cx = cx1; cx <= cx2; cx++)
+                cells[Key(cx, cy)].push_back(ref);
+    }
+
+    // Shapes whose bounds intersect r, sorted into painting order.
+    void Query(const PixelRect& r, std::vector<ShapeRef>& out) const {
+        out.clear();
+        if (IsEmpty(r)) return;
+
+        int cx1 = CellOf(r.left), cy1 = CellOf(r.top);
+        int cx2 = CellOf(r.right - 1), cy2 = CellOf(r.bottom - 1);
+        long long visit = (long long)(cx2 - cx1 + 1) * (cy2 - cy1 + 1);
+        if (visit > (long long)cells.size()) {
+            // the query covers more cells than are occupied
+            for (auto& cell : cells) {
+                int cx = (int)(int32_t)(cell.first >> 32), cy = (int)(int32_t)(uint32_t)cell.first;
+                if (cx >= cx1 && cx <= cx2 && cy >= cy1 && cy <= cy2) Collect(cell.second, r, out);
+            }
+        }
+        else {
+            for (int cy = cy1; cy <= cy2; cy++) {
+                for (int cx = cx1; cx <= cx2; cx++) {
+                    auto it = cells.find(Key(cx, cy));
+                    if (it != cells.end()) Collect(it->second, r, out);
+                }
+            }
+        }
+        Collect(large, r, out);
+
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    void QueryPoint(int x, int y, std::vector<ShapeRef>& out) const {
+        PixelRect r = { x, y, x + 1, y + 1 };
+        Query(r, out);
+    }
+
+    size_t Size() const { return count; }
+
+private:
+    int CellOf(int v) const {
+        return v >= 0 ? v / cellSize : -((-(long long)v + cellSize - 1) / cellSize);
+    }
+
+    static uint64_t Key(int cx, int cy) {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+
+    void Collect(const std::vector<ShapeRef>& refs, const PixelRect& r, std::vector<ShapeRef>& out) const {
+        for (const ShapeRef& ref : refs)
+            if (Intersects(bounds[ref.kind][ref.index], r)) out.push_back(ref);
+    }
+
+    int cellSize, maxCellsPerShape;
+    std::unordered_map<uint64_t, std::vector<ShapeRef>> cells;
+    std::vector<ShapeRef> large;
+    std::vector<PixelRect> bounds[SHAPE_KIND_COUNT];
+    size_t count;
+};
+
+
+// Boundary a flood fill at (x, y) stops at: the newest circle containing the
+// point, otherwise the newest empty square containing it. Only the advanced
+// shapes numbered below advancedBefore count; by default all do.
+inline bool FindFillBoundary(const Scene& scene, const SceneIndex& index, int x, int y, COLORREF& boundaryColor,
+    int advancedBefore = INT_MAX) {
+    std::vector<ShapeRef> hits;
+    index.QueryPoint(x, y, hits);
+
+    const CircleTable& circles = scene.circles;
+    for (auto it = hits.rbegin(); it != hits.rend(); ++it) {
+        if (it->kind != SHAPE_CIRCLES) continue;
+        int i = it->index;
+        long long dx = x - circles.xc[i], dy = y - circles.yc[i];
+        if (dx * dx + dy * dy <= (long long)circles.R[i] * circles.R[i]) {
+            boundaryColor = circles.color[i];
+            return true;
+        }
+    }
+    const AdvancedTable& advanced = scene.advanced;
+    for (auto it = hits.rbegin(); it != hits.rend(); ++it) {
+        if (it->kind != SHAPE_ADVANCED || it->index >= advancedBefore ||
+            advanced.kind[it->index] != ADVANCED_EMPTY_SQUARE)
+            continue;
+        PointSpan p = scene.Vertices(advanced.points[it->index]);
+        int left = std::min(p[0].x, p[1].x), right = std::max(p[0].x, p[1].x);
+        int top = std::min(p[0].y, p[1].y), bottom = std::max(p[0].y, p[1].y);
+        if (x >= left && x <= right && y >= top && y <= bottom) {
+            boundaryColor = advanced.color[it->index];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Gives the flood fills saved without a boundary colour the one a click at
+// their seed would have found: only the empty squares added before the fill
+// count. The tables keep no order between kinds, so every circle counts,
+// as all of them are drawn before any advanced shape. A fill with no
+// boundary keeps CLR_INVALID and paints nothing.
+inline void ResolveFillBoundaries(Scene& scene, const SceneIndex& index) {
+    AdvancedTable& advanced = scene.advanced;
+    for (int i = 0; i < advanced.Size(); i++) {
+        if (!IsFloodFill(advanced.kind[i]) || advanced.boundary[i] != CLR_INVALID || advanced.points[i].count < 1) continue;
+        Point seed = scene.Vertices(advanced.points[i])[0];
+        COLORREF boundary;
+        if (FindFillBoundary(scene, index, seed.x, seed.y, boundary, i)) advanced.boundary[i] = boundary;
+    }
+}
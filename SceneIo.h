@@ -0,0 +1,56 @@
+#pragma once
+
+// Shared by the scene readers and writers (SceneFile.h, SceneText.h).
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// Progress reporting and cancellation for one save or load. The reader or
+// writer calls Update from its own thread every few thousand records; any
+// thread may call Cancel, after which the operation fails with "cancelled".
+class SceneIoProgress {
+public:
+    explicit SceneIoProgress(std::function<void(int)> onPercent = nullptr) : onPercent(std::move(onPercent)) {}
+
+    void Cancel() { cancelled.store(true); }
+    bool Cancelled() const { return cancelled.load(); }
+
+    // Returns false once cancelled. onPercent only sees changes.
+    bool Update(uint64_t done, uint64_t total) {
+        int percent = total ? (int)(done * 100 / total) : 100;
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            if (onPercent) onPercent(percent);
+        }
+        return !Cancelled();
+    }
+
+private:
+    std::function<void(int)> onPercent;
+    std::atomic<bool> cancelled{ false };
+    int lastPercent = -1;
+};
+
+// Writers produce path + ".tmp" and move it over path only once it is
+// complete, so a failed or cancelled save leaves the previous file intact.
+inline std::string TempPathFor(const char* path) {
+    return std::string(path) + ".tmp";
+}
+
+inline bool ReplaceWithTemp(const std::string& temp, const char* path) {
+#ifdef _WIN32
+    return MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(temp.c_str(), path) == 0;
+#endif
+}
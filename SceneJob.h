@@ -0,0 +1,100 @@
+#pragma once
+
+// Runs one scene save or load at a time on a worker thread.
+//
+// A save works from a snapshot taken when it starts, so the live scene can
+// keep changing meanwhile. A load builds the new Scene (curve outlines
+// included) and its SceneIndex off-thread; the owner swaps both in once the
+// job reports completion, so the live scene is never seen half-loaded.
+//
+// onProgress and onDone run on the worker thread. The owner collects the
+// outcome with TakeResult after onDone, on its own thread.
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include "Scene.h"
+#include "SceneIndex.h"
+#include "SceneIo.h"
+
+class SceneFileJob {
+public:
+    typedef bool (*SaveFn)(const Scene&, const char*, std::string*, SceneIoProgress*);
+    typedef bool (*LoadFn)(const char*, Scene&, std::string*, SceneIoProgress*);
+
+    struct Result {
+        bool load = false;
+        bool ok = false;
+        std::string path, error;
+        std::shared_ptr<const Scene> saved; // saves
+        Scene scene;                        // loads
+        SceneIndex index;
+    };
+
+    SceneFileJob() {}
+    ~SceneFileJob() {
+        Cancel();
+        if (worker.joinable()) worker.join();
+    }
+
+    SceneFileJob(const SceneFileJob&) = delete;
+    SceneFileJob& operator=(const SceneFileJob&) = delete;
+
+    // True from Start until the result is taken.
+    bool Busy() const { return busy; }
+
+    bool StartSave(std::shared_ptr<const Scene> snapshot, const std::string& path, SaveFn save,
+        std::function<void(int)> onProgress, std::function<void()> onDone) {
+        return Start(false, path, std::move(onProgress), std::move(onDone), [snapshot, save](Result& r, SceneIoProgress& progress) {
+            r.saved = snapshot;
+            r.ok = save(*snapshot, r.path.c_str(), &r.error, &progress);
+        });
+    }
+
+    bool StartLoad(const std::string& path, LoadFn load, std::function<void(int)> onProgress, std::function<void()> onDone) {
+        return Start(true, path, std::move(onProgress), std::move(onDone), [load](Result& r, SceneIoProgress& progress) {
+            r.ok = load(r.path.c_str(), r.scene, &r.error, &progress);
+            if (r.ok) {
+                RefreshCurveOutlines(r.scene);
+                r.index.Rebuild(r.scene);
+            }
+        });
+    }
+
+    void Cancel() {
+        if (progress) progress->Cancel();
+    }
+
+    // Waits for the worker if it is still running.
+    std::unique_ptr<Result> TakeResult() {
+        if (worker.joinable()) worker.join();
+        busy = false;
+        progress.reset();
+        return std::move(result);
+    }
+
+private:
+    bool Start(bool load, const std::string& path, std::function<void(int)> onProgress, std::function<void()> onDone,
+        std::function<void(Result&, SceneIoProgress&)> work) {
+        if (busy) return false;
+        if (worker.joinable()) worker.join();
+        busy = true;
+        result.reset(new Result);
+        result->load = load;
+        result->path = path;
+        progress.reset(new SceneIoProgress(std::move(onProgress)));
+        Result* r = result.get();
+        SceneIoProgress* p = progress.get();
+        worker = std::thread([r, p, work, onDone] {
+            work(*r, *p);
+            if (onDone) onDone();
+        });
+        return true;
+    }
+
+    std::thread worker;
+    bool busy = false;
+    std::unique_ptr<SceneIoProgress> progress;
+    std::unique_ptr<Result> result;
+};
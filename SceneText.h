@@ -0,0 +1,542 @@
+#pragma once
+
+// Text scene file (shapes.txt).
+//
+// A section starts with its name alone on a line and holds one record per
+// line until the next section name:
+//
+//   Lines           x1 y1 x2 y2 r g b [algorithm]
+//   Points          x y
+//   Circles         xc yc R r g b quarter algorithm
+//   Ellipse         xc yc a b r g b quarter algorithm
+//   Spline          n x1 y1 ... xn yn c r g b
+//   Polygon         x1 y1 ... x4 y4 r g b [xl xr yt yb]
+//   BezierCurves    x0 y0 ... x3 y3 r0 g0 b0 ... r3 g3 b3
+//   HermiteCurves   p0x p0y p1x p1y t0x t0y t1x t1y r g b
+//   AdvancedShapes  type n x1 y1 ... xn yn r g b [boundary-r g b]
+//
+// The clipping state uses single-line records that may appear anywhere:
+// ClippingMethod m, ClippingRect l t r b, ClippingSquare l t r b and
+// ClippingState enabled enabledSquare rectDrawn squareDrawn. Bracketed
+// fields are optional so files from older versions still load; an advanced
+// shape type must be one of AdvancedKindNames, and only flood fills store a
+// boundary colour.
+//
+// The parser makes a single pass over the mapped file with hand-written
+// number scanning (no iostreams, no locale) and stops at the first bad
+// token, reporting its line and column.
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Scene.h"
+#include "MappedFile.h"
+#include "SceneIo.h"
+
+enum SceneTextSection {
+    TEXT_NONE,
+    TEXT_LINES,
+    TEXT_POINTS,
+    TEXT_CIRCLES,
+    TEXT_ELLIPSES,
+    TEXT_SPLINES,
+    TEXT_POLYGONS,
+    TEXT_BEZIERS,
+    TEXT_HERMITES,
+    TEXT_ADVANCED,
+    TEXT_CLIPPING_METHOD,
+    TEXT_CLIPPING_RECT,
+    TEXT_CLIPPING_SQUARE,
+    TEXT_CLIPPING_STATE
+};
+
+struct SceneTextKeyword {
+    const char* name;
+    SceneTextSection section;
+};
+
+static const SceneTextKeyword SceneTextKeywords[] = {
+    { "Lines", TEXT_LINES },
+    { "Points", TEXT_POINTS },
+    { "Circles", TEXT_CIRCLES },
+    { "Ellipse", TEXT_ELLIPSES },
+    { "Spline", TEXT_SPLINES },
+    { "Polygon", TEXT_POLYGONS },
+    { "BezierCurves", TEXT_BEZIERS },
+    { "HermiteCurves", TEXT_HERMITES },
+    { "AdvancedShapes", TEXT_ADVANCED },
+    { "ClippingMethod", TEXT_CLIPPING_METHOD },
+    { "ClippingRect", TEXT_CLIPPING_RECT },
+    { "ClippingSquare", TEXT_CLIPPING_SQUARE },
+    { "ClippingState", TEXT_CLIPPING_STATE }
+};
+
+
+class SceneTextWriter {
+public:
+    bool Write(const Scene& scene, const char* path, std::string* error, SceneIoProgress* progress = nullptr) {
+        const std::string temp = TempPathFor(path);
+        file = std::fopen(temp.c_str(), "wb");
+        if (!file) return Fail(error, "cannot create " + temp);
+        buffer.clear();
+        buffer.reserve(FlushSize + 4096);
+        this->progress = progress;
+        records = 0;
+        totalRecords = 4; // the clipping records
+        for (int k = 0; k < SHAPE_KIND_COUNT; k++) totalRecords += ShapeCount(scene, (ShapeKind)k);
+        cancelled = false;
+
+        Text("Lines\n");
+        const LineTable& l = scene.lines;
+        for (int i = 0; i < l.Size() && !cancelled; i++) {
+            Int(l.ends.x1[i]); Int(l.ends.y1[i]); Int(l.ends.x2[i]); Int(l.ends.y2[i]);
+            Color(l.color[i]); Int(l.algorithm[i]); EndLine();
+        }
+        Text("ClippingMethod "); Int(scene.currentClippingMethod); EndLine();
+        Text("ClippingRect "); Rect(scene.clippingRect); EndLine();
+        Text("ClippingSquare "); Rect(scene.clippingSquare); EndLine();
+        Text("ClippingState ");
+        Int(scene.clippingEnabled); Int(scene.clippingEnabledSquare);
+        Int(scene.clippingRectDrawn); Int(scene.clippingSquareDrawn);
+        EndLine();
+
+        Text("Points\n");
+        const PointTable& points = scene.points;
+        for (int i = 0; i < points.Size() && !cancelled; i++) {
+            Int(points.x[i]); Int(points.y[i]); EndLine();
+        }
+        Text("Circles\n");
+        const CircleTable& c = scene.circles;
+        for (int i = 0; i < c.Size() && !cancelled; i++) {
+            Int(c.xc[i]); Int(c.yc[i]); Int(c.R[i]); Color(c.color[i]); Int(c.quarter[i]); Int(c.algorithm[i]); EndLine();
+        }
+        Text("Ellipse\n");
+        const EllipseTable& e = scene.ellipses;
+        for (int i = 0; i < e.Size() && !cancelled; i++) {
+            Int(e.xc[i]); Int(e.yc[i]); Int(e.a[i]); Int(e.b[i]); Color(e.color[i]); Int(e.quarter[i]); Int(e.algorithm[i]); EndLine();
+        }
+        Text("Spline\n");
+        const SplineTable& s = scene.splines;
+        for (int i = 0; i < s.Size() && !cancelled; i++) {
+            Int(s.points[i].count);
+            Vertices(scene.Vertices(s.points[i]));
+            Double(s.c[i]); Color(s.color[i]); EndLine();
+        }
+        Text("Polygon\n");
+        const PolygonTable& p = scene.polygons;
+        for (int i = 0; i < p.Size() && !cancelled; i++) {
+            Vertices(scene.Vertices(p.points[i]));
+            Color(p.color[i]); Int(p.xl[i]); Int(p.xr[i]); Int(p.yt[i]); Int(p.yb[i]); EndLine();
+        }
+        Text("BezierCurves\n");
+        const BezierTable& b = scene.beziers;
+        for (int i = 0; i < b.Size() && !cancelled; i++) {
+            Vertex(b.p0[i]); Vertex(b.p1[i]); Vertex(b.p2[i]); Vertex(b.p3[i]);
+            Color(b.c0[i]); Color(b.c1[i]); Color(b.c2[i]); Color(b.c3[i]); EndLine();
+        }
+        Text("HermiteCurves\n");
+        const HermiteTable& h = scene.hermites;
+        for (int i = 0; i < h.Size() && !cancelled; i++) {
+            Vertex(h.p0[i]); Vertex(h.p1[i]); Vertex(h.t0[i]); Vertex(h.t1[i]);
+            Color(h.color[i]); EndLine();
+        }
+        Text("AdvancedShapes\n");
+        const AdvancedTable& a = scene.advanced;
+        for (int i = 0; i < a.Size() && !cancelled; i++) {
+            Text(AdvancedKindNames[a.kind[i]]); buffer += ' ';
+            Int(a.points[i].count);
+            Vertices(scene.Vertices(a.points[i]));
+            Color(a.color[i]);
+            if (a.boundary[i] != CLR_INVALID) Color(a.boundary[i]);
+            EndLine();
+        }
+
+        Flush();
+        bool ok = !std::ferror(file);
+        ok = std::fclose(file) == 0 && ok;
+        file = nullptr;
+        if (cancelled || !ok || !ReplaceWithTemp(temp, path)) {
+            std::remove(temp.c_str());
+            return Fail(error, cancelled ? std::string("cancelled") : std::string("error writing ") + path);
+        }
+        return true;
+    }
+
+private:
+    static const size_t FlushSize = 1 << 20;
+
+    void Text(const char* s) { buffer += s; }
+
+    void Int(int v) {
+        char digits[12];
+        int n = 0;
+        unsigned u = v < 0 ? 0u - (unsigned)v : (unsigned)v;
+        do { digits[n++] = (char)('0' + u % 10); u /= 10; } while (u);
+        if (v < 0) buffer += '-';
+        while (n) buffer += digits[--n];
+        buffer += ' ';
+    }
+
+    void Double(double v) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.17g ", v);
+        buffer += text;
+    }
+
+    void Vertex(Point p) { Int(p.x); Int(p.y); }
+    void Vertices(PointSpan span) { for (Point v : span) Vertex(v); }
+    void Color(COLORREF c) { Int(GetRValue(c)); Int(GetGValue(c)); Int(GetBValue(c)); }
+    void Rect(const ClipRect& r) { Int(r.left); Int(r.top); Int(r.right); Int(r.bottom); }
+
+    void EndLine() {
+        buffer.back() = '\n';
+        records++;
+        if (buffer.size() >= FlushSize) Flush();
+    }
+
+    // Once cancelled nothing more is written and the loops stop.
+    void Flush() {
+        if (!cancelled) std::fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+        if (progress && !progress->Update(records, totalRecords)) cancelled = true;
+    }
+
+    static bool Fail(std::string* error, const std::string& message) {
+        if (error) *error = message;
+        return false;
+    }
+
+    FILE* file = nullptr;
+    std::string buffer;
+    SceneIoProgress* progress = nullptr;
+    uint64_t records = 0, totalRecords = 0;
+    bool cancelled = false;
+};
+
+inline bool SaveSceneText(const Scene& scene, const char* path, std::string* error = nullptr, SceneIoProgress* progress = nullptr) {
+    SceneTextWriter writer;
+    return writer.Write(scene, path, error, progress);
+}
+
+
+// Parses a whole file image. On failure the destination scene is left
+// untouched and *error reads "line L, column C: ...".
+class SceneTextParser {
+public:
+    SceneTextParser(const char* data, size_t size) : begin(data), p(data), end(data + size), lineStart(data) {}
+
+    bool Parse(Scene& out, std::string* error, SceneIoProgress* progress = nullptr) {
+        Scene scene;
+        SceneTextSection section = TEXT_NONE;
+        err = error;
+        const char* nextReport = p;
+
+        for (;;) {
+            SkipBlankLines();
+            if (p == end) break;
+            token = p;
+            if (progress && p >= nextReport) {
+                if (!progress->Update(p - begin, end - begin)) {
+                    if (err) *err = "cancelled";
+                    return false;
+                }
+                nextReport = p + (1 << 16);
+            }
+
+            if (IsAlpha(*p)) {
+                const char* word = p;
+                while (p < end && !IsSpace(*p)) p++;
+                SceneTextSection keyword = Keyword(word, p - word);
+                if (keyword == TEXT_NONE) {
+                    if (section != TEXT_ADVANCED) return Fail("unknown section name");
+                    if (!AdvancedRecord(word, p - word, scene)) return false;
+                }
+                else if (keyword >= TEXT_CLIPPING_METHOD) {
+                    if (!ClippingRecord(keyword, scene)) return false;
+                }
+                else {
+                    section = keyword;
+                    if (!EndRecord()) return false;
+                }
+                continue;
+            }
+
+            if (!Record(section, scene)) return false;
+        }
+
+        out = std::move(scene);
+        return true;
+    }
+
+private:
+    static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+    static bool IsAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+    static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+    static SceneTextSection Keyword(const char* word, size_t length) {
+        for (const SceneTextKeyword& k : SceneTextKeywords)
+            if (std::strlen(k.name) == length && std::memcmp(k.name, word, length) == 0) return k.section;
+        return TEXT_NONE;
+    }
+
+    void SkipBlankLines() {
+        while (p < end && IsSpace(*p)) {
+            if (*p == '\n') NewLine();
+            else p++;
+        }
+    }
+
+    void SkipSpaces() {
+        const char* q = p;
+        while (q < end && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+        p = q;
+    }
+
+    void NewLine() {
+        p++;
+        line++;
+        lineStart = p;
+    }
+
+    bool AtLineEnd() {
+        SkipSpaces();
+        return p == end || *p == '\n';
+    }
+
+    bool EndRecord() {
+        if (!AtLineEnd()) {
+            token = p;
+            return Fail("unexpected extra value at the end of the record");
+        }
+        if (p < end) NewLine();
+        return true;
+    }
+
+    // Works on a local cursor: p is a member, and every char read could
+    // alias it, which would force a store of p per digit.
+    bool Int(int& v) {
+        const char* q = p;
+        while (q < end && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+        token = p = q;
+        if (q == end || *q == '\n') return Fail("record ends early, expected an integer");
+        bool negative = false;
+        if (*q == '-' || *q == '+') negative = *q++ == '-';
+        if (q == end || !IsDigit(*q)) return Fail("expected an integer");
+        const char* digits = q;
+        unsigned long long value = 0;
+        while (q < end && IsDigit(*q)) value = value * 10 + (unsigned)(*q++ - '0');
+        p = q;
+        if (q - digits > 10 || value > (unsigned long long)INT_MAX + negative) return Fail("integer out of range");
+        if (q < end && !IsSpace(*q)) return Fail("expected an integer");
+        v = negative ? (int)(0 - value) : (int)value;
+        return true;
+    }
+
+    // Plain decimal with an optional exponent, independent of the C locale.
+    bool Double(double& v) {
+        SkipSpaces();
+        token = p;
+        if (p == end || *p == '\n') return Fail("record ends early, expected a number");
+        bool negative = false;
+        if (*p == '-' || *p == '+') negative = *p++ == '-';
+        double value = 0;
+        int digits = 0, scale = 0;
+        while (p < end && IsDigit(*p)) { value = value * 10 + (*p++ - '0'); digits++; }
+        if (p < end && *p == '.') {
+            p++;
+            while (p < end && IsDigit(*p)) { value = value * 10 + (*p++ - '0'); digits++; scale--; }
+        }
+        if (digits == 0) return Fail("expected a number");
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+')) negativeExponent = *p++ == '-';
+            if (p == end || !IsDigit(*p)) return Fail("expected a number");
+            int exponent = 0;
+            while (p < end && IsDigit(*p)) exponent = std::min(exponent * 10 + (*p++ - '0'), 1000);
+            scale += negativeExponent ? -exponent : exponent;
+        }
+        if (p < end && !IsSpace(*p)) return Fail("expected a number");
+        if (scale < -400 || scale > 400) return Fail("number out of range");
+        double power = 1;
+        for (int i = 0, n = scale < 0 ? -scale : scale; i < n; i++) power *= 10;
+        value = scale < 0 ? value / power : value * power;
+        v = negative ? -value : value;
+        return true;
+    }
+
+    bool Color(COLORREF& c) {
+        int r, g, b;
+        if (!Int(r) || !Color8(r) || !Int(g) || !Color8(g) || !Int(b) || !Color8(b)) return false;
+        c = RGB(r, g, b);
+        return true;
+    }
+
+    bool Color8(int v) { return v >= 0 && v <= 255 ? true : Fail("color component must be 0 to 255"); }
+
+    bool PointValue(Point& v) { return Int(v.x) && Int(v.y); }
+
+    // Reads n points straight into the scene's vertex pool.
+    bool Vertices(int n, Scene& scene, PointRange& range) {
+        range.first = (int)scene.vertices.size();
+        range.count = n;
+        for (int i = 0; i < n; i++) {
+            Point v;
+            if (!PointValue(v)) return false;
+            scene.vertices.push_back(v);
+        }
+        return true;
+    }
+
+    // Every point takes at least four characters ("0 0 "), so a count the
+    // rest of the file cannot hold is rejected before allocating for it.
+    bool Count(int& n) {
+        if (!Int(n)) return false;
+        if (n < 0) return Fail("point count cannot be negative");
+        if ((size_t)n > (size_t)(end - p) / 4 + 1) return Fail("point count is larger than the file");
+        return true;
+    }
+
+    bool Record(SceneTextSection section, Scene& scene) {
+        switch (section) {
+        case TEXT_LINES: {
+            Line l;
+            l.algorithm = 0;
+            if (!Int(l.x1) || !Int(l.y1) || !Int(l.x2) || !Int(l.y2) || !Color(l.color)) return false;
+            if (!AtLineEnd() && !Int(l.algorithm)) return false;
+            scene.lines.Push(l);
+            break;
+        }
+        case TEXT_POINTS: {
+            Point v;
+            if (!PointValue(v)) return false;
+            scene.points.Push(v);
+            break;
+        }
+        case TEXT_CIRCLES: {
+            Circle c;
+            if (!Int(c.xc) || !Int(c.yc) || !Int(c.R) || !Color(c.color) || !Int(c.quarter) || !Int(c.algorithm)) return false;
+            scene.circles.Push(c);
+            break;
+        }
+        case TEXT_ELLIPSES: {
+            Ellipsee e;
+            if (!Int(e.xc) || !Int(e.yc) || !Int(e.a) || !Int(e.b) || !Color(e.color) || !Int(e.quarter) || !Int(e.algorithm)) return false;
+            scene.ellipses.Push(e);
+            break;
+        }
+        case TEXT_SPLINES: {
+            int n;
+            PointRange points;
+            double c;
+            COLORREF color;
+            if (!Count(n)) return false;
+            if (n == 0) return Fail("a spline needs at least one point");
+            if (!Vertices(n, scene, points) || !Double(c) || !Color(color)) return false;
+            scene.splines.Push(points, c, color);
+            break;
+        }
+        case TEXT_POLYGONS: {
+            PointRange points;
+            COLORREF color;
+            int xl, xr, yt, yb;
+            if (!Vertices(4, scene, points) || !Color(color)) return false;
+            if (!AtLineEnd()) {
+                if (!Int(xl) || !Int(xr) || !Int(yt) || !Int(yb)) return false;
+            }
+            else {
+                // older files did not store the window: use one that keeps
+                // the whole polygon
+                PixelRect b = PointsBounds(scene.Vertices(points).data, 4);
+                xl = b.left; xr = b.right;
+                yt = b.top; yb = b.bottom;
+            }
+            scene.polygons.Push(points, xl, xr, yt, yb, color);
+            break;
+        }
+        case TEXT_BEZIERS: {
+            BezierCurve b;
+            if (!PointValue(b.p0) || !PointValue(b.p1) || !PointValue(b.p2) || !PointValue(b.p3)) return false;
+            if (!Color(b.c0) || !Color(b.c1) || !Color(b.c2) || !Color(b.c3)) return false;
+            scene.beziers.Push(b);
+            break;
+        }
+        case TEXT_HERMITES: {
+            HermiteCurve h;
+            if (!PointValue(h.p0) || !PointValue(h.p1) || !PointValue(h.t0) || !PointValue(h.t1) || !Color(h.color)) return false;
+            scene.hermites.Push(h);
+            break;
+        }
+        case TEXT_ADVANCED:
+            return Fail("expected a shape type");
+        default:
+            return Fail("record outside of any section");
+        }
+        return EndRecord();
+    }
+
+    bool AdvancedRecord(const char* type, size_t length, Scene& scene) {
+        AdvancedKind kind;
+        if (!AdvancedKindFromName(type, length, kind)) return Fail("unknown shape type");
+        int n;
+        PointRange points;
+        COLORREF color, boundary = CLR_INVALID;
+        if (!Count(n) || !Vertices(n, scene, points) || !Color(color)) return false;
+        if (IsFloodFill(kind) && !AtLineEnd() && !Color(boundary)) return false;
+        scene.advanced.Push(kind, points, color, boundary);
+        return EndRecord();
+    }
+
+    bool ClippingRecord(SceneTextSection keyword, Scene& scene) {
+        switch (keyword) {
+        case TEXT_CLIPPING_METHOD: {
+            int method;
+            if (!Int(method)) return false;
+            if (method < None || method > SQUARE) return Fail("unknown clipping method");
+            scene.currentClippingMethod = (ClippingMethod)method;
+            break;
+        }
+        case TEXT_CLIPPING_RECT:
+        case TEXT_CLIPPING_SQUARE: {
+            ClipRect& r = keyword == TEXT_CLIPPING_RECT ? scene.clippingRect : scene.clippingSquare;
+            if (!Int(r.left) || !Int(r.top) || !Int(r.right) || !Int(r.bottom)) return false;
+            break;
+        }
+        default: {
+            int flags[4];
+            for (int& f : flags)
+                if (!Int(f)) return false;
+            scene.clippingEnabled = flags[0] != 0;
+            scene.clippingEnabledSquare = flags[1] != 0;
+            scene.clippingRectDrawn = flags[2] != 0;
+            scene.clippingSquareDrawn = flags[3] != 0;
+            break;
+        }
+        }
+        return EndRecord();
+    }
+
+    bool Fail(const char* message) {
+        if (err)
+            *err = "line " + std::to_string(line) + ", column " + std::to_string(token - lineStart + 1) + ": " + message;
+        return false;
+    }
+
+    const char* begin;
+    const char* p;
+    const char* end;
+    const char* lineStart;
+    const char* token = nullptr;
+    int line = 1;
+    std::string* err = nullptr;
+};
+
+inline bool LoadSceneText(const char* path, Scene& out, std::string* error = nullptr, SceneIoProgress* progress = nullptr) {
+    MappedFile file;
+    if (!file.Open(path, error)) return false;
+    SceneTextParser parser((const char*)file.Data(), file.Size());
+    return parser.Parse(out, error, progress);
+}
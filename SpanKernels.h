@@ -0,0 +1,183 @@
+#pragma once
+
+// Kernels that write a run of 32-bit pixels: a solid colour, or another run
+// laid over it. FillSpan and the fills built on it end up here, and so does
+// compositing layers.
+//
+// There is a scalar, an SSE2 and an AVX2 version of each kernel. All of them
+// are compiled into the same binary, with per-function target attributes
+// under GCC/Clang, and ActiveSpanKernels picks the best one the running CPU
+// supports the first time a span is written. No -mavx2 or /arch flag is
+// needed, and a build made on an AVX2 machine still runs on one without.
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SPAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define SPAN_TARGET_SSE2 __attribute__((target("sse2")))
+#define SPAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SPAN_TARGET_SSE2
+#define SPAN_TARGET_AVX2
+#endif
+#endif
+
+// A layer pixel nothing was drawn on. Drawn pixels are 0x00RRGGBB, so only
+// this one has its top bit set.
+const uint32_t TransparentPixel = 0xFF000000u;
+
+inline void FillPixelsScalar(uint32_t* dst, size_t n, uint32_t pixel) {
+    for (size_t i = 0; i < n; i++) dst[i] = pixel;
+}
+
+// dst[i] = src[i] wherever src[i] is not transparent.
+inline void OverPixelsScalar(uint32_t* dst, const uint32_t* src, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        if (!(src[i] & 0x80000000u)) dst[i] = src[i];
+}
+
+#if SPAN_X86
+
+// The head is written one pixel at a time up to the vector alignment, so
+// the loop below only issues aligned stores.
+SPAN_TARGET_SSE2 inline void FillPixelsSse2(uint32_t* dst, size_t n, uint32_t pixel) {
+    size_t i = 0;
+    for (; i < n && ((uintptr_t)(dst + i) & 15) != 0; i++) dst[i] = pixel;
+    __m128i v = _mm_set1_epi32((int)pixel);
+    for (; i + 16 <= n; i += 16) {
+        _mm_store_si128((__m128i*)(dst + i), v);
+        _mm_store_si128((__m128i*)(dst + i + 4), v);
+        _mm_store_si128((__m128i*)(dst + i + 8), v);
+        _mm_store_si128((__m128i*)(dst + i + 12), v);
+    }
+    for (; i + 4 <= n; i += 4) _mm_store_si128((__m128i*)(dst + i), v);
+    for (; i < n; i++) dst[i] = pixel;
+}
+
+// The sign bit of each pixel is its mask. Layers are drawn pixels and
+// holes mixed at random, so a blend of every block beats branching on its
+// mask.
+SPAN_TARGET_SSE2 inline void OverPixelsSse2(uint32_t* dst, const uint32_t* src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i m = _mm_srai_epi32(s, 31);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(m, d), _mm_andnot_si128(m, s)));
+    }
+    OverPixelsScalar(dst + i, src + i, n - i);
+}
+
+SPAN_TARGET_AVX2 inline void FillPixelsAvx2(uint32_t* dst, size_t n, uint32_t pixel) {
+    size_t i = 0;
+    for (; i < n && ((uintptr_t)(dst + i) & 31) != 0; i++) dst[i] = pixel;
+    __m256i v = _mm256_set1_epi32((int)pixel);
+    for (; i + 32 <= n; i += 32) {
+        _mm256_store_si256((__m256i*)(dst + i), v);
+        _mm256_store_si256((__m256i*)(dst + i + 8), v);
+        _mm256_store_si256((__m256i*)(dst + i + 16), v);
+        _mm256_store_si256((__m256i*)(dst + i + 24), v);
+    }
+    for (; i + 8 <= n; i += 8) _mm256_store_si256((__m256i*)(dst + i), v);
+    for (; i < n; i++) dst[i] = pixel;
+}
+
+// A masked store writes the drawn pixels without reading dst at all.
+SPAN_TARGET_AVX2 inline void OverPixelsAvx2(uint32_t* dst, const uint32_t* src, size_t n) {
+    const __m256i ones = _mm256_set1_epi32(-1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_maskstore_epi32((int*)(dst + i), _mm256_xor_si256(_mm256_srai_epi32(s, 31), ones), s);
+    }
+    OverPixelsScalar(dst + i, src + i, n - i);
+}
+
+#endif
+
+
+enum SpanIsa { SPAN_SCALAR, SPAN_SSE2, SPAN_AVX2 };
+
+struct SpanKernels {
+    SpanIsa isa;
+    const char* name;
+    void (*fill)(uint32_t* dst, size_t n, uint32_t pixel);
+    void (*over)(uint32_t* dst, const uint32_t* src, size_t n);
+};
+
+// Best instruction set this CPU and OS can run.
+inline SpanIsa DetectSpanIsa() {
+#if SPAN_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    // AVX state must be enabled by the OS (OSXSAVE, then XCR0 bits 1-2)
+    bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    if (avx && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) return SPAN_AVX2;
+    }
+    return sse2 ? SPAN_SSE2 : SPAN_SCALAR;
+#elif SPAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SPAN_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SPAN_SSE2;
+    return SPAN_SCALAR;
+#else
+    return SPAN_SCALAR;
+#endif
+}
+
+// Kernels for isa, or null if this build has none for it. Whether the CPU
+// can run them is the caller's business (see DetectSpanIsa).
+inline const SpanKernels* SpanKernelsFor(SpanIsa isa) {
+    static const SpanKernels scalar = { SPAN_SCALAR, "scalar", FillPixelsScalar, OverPixelsScalar };
+#if SPAN_X86
+    static const SpanKernels sse2 = { SPAN_SSE2, "SSE2", FillPixelsSse2, OverPixelsSse2 };
+    static const SpanKernels avx2 = { SPAN_AVX2, "AVX2", FillPixelsAvx2, OverPixelsAvx2 };
+    if (isa == SPAN_AVX2) return &avx2;
+    if (isa == SPAN_SSE2) return &sse2;
+#endif
+    return isa == SPAN_SCALAR ? &scalar : nullptr;
+}
+
+inline const SpanKernels*& ActiveSpanKernelsSlot() {
+    static const SpanKernels* active = SpanKernelsFor(DetectSpanIsa());
+    return active;
+}
+
+inline const SpanKernels& ActiveSpanKernels() {
+    return *ActiveSpanKernelsSlot();
+}
+
+// Switches every later span to isa's kernels, for benchmarks and
+// comparisons. False, and nothing changes, if the build or CPU lacks it.
+// Not for use while anything is drawing.
+inline bool UseSpanKernels(SpanIsa isa) {
+    const SpanKernels* k = SpanKernelsFor(isa);
+    if (!k || isa > DetectSpanIsa()) return false;
+    ActiveSpanKernelsSlot() = k;
+    return true;
+}
+
+// Short runs, the common case for small shapes, are cheaper written inline
+// than through the kernel's function pointer.
+const size_t SpanKernelMinPixels = 16;
+
+inline void FillPixels(uint32_t* dst, size_t n, uint32_t pixel) {
+    if (n < SpanKernelMinPixels) FillPixelsScalar(dst, n, pixel);
+    else ActiveSpanKernels().fill(dst, n, pixel);
+}
+
+inline void OverPixels(uint32_t* dst, const uint32_t* src, size_t n) {
+    if (n < SpanKernelMinPixels) OverPixelsScalar(dst, src, n);
+    else ActiveSpanKernels().over(dst, src, n);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+// Fork-join pool with per-thread task queues and work stealing.
+//
+// Run(count, fn) spreads the indices [0, count) round-robin over the
+// queues and blocks until every fn(i) has returned; the calling thread
+// works through queue 0 meanwhile. A thread that drains its own queue
+// steals from the back of the others, so uneven tasks (a tile full of
+// filled circles next to an empty one) still keep every core busy.
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    // threads counts the caller; threads - 1 workers are started.
+    explicit WorkStealingPool(int threads = (int)std::thread::hardware_concurrency()) {
+        if (threads < 1) threads = 1;
+        for (int i = 0; i < threads; i++) queues.emplace_back(new Queue);
+        for (int i = 1; i < threads; i++) workers.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int Threads() const { return (int)queues.size(); }
+
+    void Run(int count, const std::function<void(int)>& fn) {
+        if (count <= 0) return;
+        if (count == 1 || workers.empty()) {
+            for (int i = 0; i < count; i++) fn(i);
+            return;
+        }
+
+        job = &fn;
+        remaining.store(count);
+        for (int i = 0; i < count; i++) {
+            Queue& q = *queues[i % queues.size()];
+            std::lock_guard<std::mutex> lock(q.m);
+            q.tasks.push_back(i);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m);
+            generation++;
+        }
+        wake.notify_all();
+
+        Drain(0);
+
+        std::unique_lock<std::mutex> lock(m);
+        finished.wait(lock, [this] { return remaining.load() == 0; });
+    }
+
+private:
+    // tasks[head, end) are queued. Emptied queues start over at the front,
+    // so once they have grown they never allocate (a deque would, as its
+    // blocks rotate).
+    struct Queue {
+        std::mutex m;
+        std::vector<int> tasks;
+        size_t head = 0;
+
+        bool Empty() const { return head == tasks.size(); }
+
+        void Taken() {
+            if (Empty()) {
+                tasks.clear();
+                head = 0;
+            }
+        }
+    };
+
+    // Own queue from the front, then the others from the back.
+    bool TryPop(int self, int& task) {
+        {
+            Queue& q = *queues[self];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (!q.Empty()) {
+                task = q.tasks[q.head++];
+                q.Taken();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); k++) {
+            Queue& q = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (!q.Empty()) {
+                task = q.tasks.back();
+                q.tasks.pop_back();
+                q.Taken();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Drain(int self) {
+        int task;
+        while (TryPop(self, task)) {
+            // job is published before any task is queued, and the queue
+            // mutex orders the two
+            (*job)(task);
+            if (remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m);
+                finished.notify_all();
+            }
+        }
+    }
+
+    void WorkerLoop(int self) {
+        unsigned seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            Drain(self);
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable wake, finished;
+    const std::function<void(int)>* job = nullptr;
+    std::atomic<int> remaining{ 0 };
+    unsigned generation = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+// Tile-parallel version of DrawAllShapes.
+//
+// The area to redraw is cut into square tiles. Every shape is binned into
+// the tiles its ShapeBounds overlaps, walking the scene in painting order so
+// each bin is already sorted. Tiles are then cleared and drawn concurrently
+// on a WorkStealingPool, each through a RenderTarget clipped to the tile.
+// Tiles never share a pixel and the raster routines never read the target,
+// so the frame is bit-identical to the serial path for any thread count.
+//
+// A shape is rasterized once for every tile it touches (only the writes are
+// clipped), so by default the tile size gives about four tiles per thread:
+// enough for stealing to even out the load, few enough that large shapes
+// are not redrawn many times. With one thread the area is a single tile.
+//
+// Given a DisplayList, the shapes are compiled into it first (on the same
+// pool) and the tiles replay its entries instead of running the algorithms.
+
+#include <vector>
+#include <cmath>
+#include <functional>
+#include <algorithm>
+#include "Scene.h"
+#include "DisplayList.h"
+#include "ThreadPool.h"
+
+class TileRenderer {
+public:
+    // tileSize <= 0 picks it from the area and the pool size on every Render.
+    explicit TileRenderer(WorkStealingPool& pool, int tileSize = 0) : pool(pool), fixedTileSize(tileSize) {}
+
+    // Clears rt.clip to background and draws the whole scene into it.
+    void Render(RenderTarget& rt, const Scene& scene, COLORREF background) {
+        candidates.clear();
+        for (int k = 0; k < SHAPE_KIND_COUNT; k++) {
+            int n = ShapeCount(scene, (ShapeKind)k);
+            for (int i = 0; i < n; i++) {
+                ShapeRef ref = { (ShapeKind)k, i };
+                candidates.push_back(ref);
+            }
+        }
+        Render(rt, scene, candidates, background);
+    }
+
+    // Same, limited to shapes, in painting order, that may touch rt.clip
+    // (a SceneIndex query, for instance). With a display list, the shapes
+    // come from it.
+    void Render(RenderTarget& rt, const Scene& scene, const std::vector<ShapeRef>& shapes, COLORREF background,
+        DisplayList* displayList = nullptr) {
+        RenderTiles(rt, scene, shapes, ToPixel(background), true, displayList);
+    }
+
+    // Layer version: rt.clip is cleared to TransparentPixel and only the
+    // shapes are drawn, no clip outline.
+    void RenderLayer(RenderTarget& rt, const Scene& scene, const std::vector<ShapeRef>& shapes,
+        DisplayList* displayList = nullptr) {
+        RenderTiles(rt, scene, shapes, TransparentPixel, false, displayList);
+    }
+
+private:
+    void RenderTiles(RenderTarget& rt, const Scene& scene, const std::vector<ShapeRef>& shapes, uint32_t clear,
+        bool clipOutline, DisplayList* displayList) {
+        const PixelRect area = rt.clip;
+        if (IsEmpty(area)) return;
+        if (displayList) {
+            PixelRect canvas = { 0, 0, rt.width, rt.height };
+            displayList->Prepare(scene, shapes, area, canvas, &pool);
+        }
+
+        int areaW = area.right - area.left, areaH = area.bottom - area.top;
+        tileSize = fixedTileSize > 0 ? fixedTileSize : AutoTileSize(areaW, areaH);
+        tilesX = (areaW + tileSize - 1) / tileSize;
+        tilesY = (areaH + tileSize - 1) / tileSize;
+        int tiles = tilesX * tilesY;
+
+        if ((int)bins.size() < tiles) bins.resize(tiles);
+        for (int t = 0; t < tiles; t++) bins[t].clear();
+
+        for (const ShapeRef& ref : shapes) {
+            PixelRect b = Intersect(ShapeBounds(scene, ref), area);
+            if (IsEmpty(b)) continue;
+            int x1 = (b.left - area.left) / tileSize, x2 = (b.right - 1 - area.left) / tileSize;
+            int y1 = (b.top - area.top) / tileSize, y2 = (b.bottom - 1 - area.top) / tileSize;
+            for (int ty = y1; ty <= y2; ty++)
+                for (int tx = x1; tx <= x2; tx++)
+                    bins[ty * tilesX + tx].push_back(ref);
+        }
+
+        ClipWindow w = ActiveClipWindow(scene);
+        auto drawTile = [&](int t) {
+            int x = area.left + t % tilesX * tileSize, y = area.top + t / tilesX * tileSize;
+            PixelRect tile = { x, y, x + tileSize, y + tileSize };
+            RenderTarget tileRt = ClipTarget(rt, tile);
+            if (IsEmpty(tileRt.clip)) return;
+            const PixelRect& c = tileRt.clip;
+            for (int y = c.top; y < c.bottom; y++)
+                FillPixels(PixelAt(tileRt, c.left, y), (size_t)(c.right - c.left), clear);
+            if (clipOutline) DrawClipOutline(tileRt, scene, w);
+            if (displayList) DrawDisplayList(tileRt, scene, w, *displayList, bins[t].data(), bins[t].size());
+            else DrawShapeList(tileRt, scene, w, bins[t].data(), bins[t].size());
+        };
+        // a std::function holds a reference without allocating; the lambda
+        // itself would not fit in its small buffer
+        pool.Run(tiles, std::cref(drawTile));
+    }
+
+    int AutoTileSize(int w, int h) const {
+        int threads = pool.Threads();
+        if (threads == 1) return std::max(w, h);
+        double side = std::sqrt((double)w * h / (4.0 * threads));
+        int t = ((int)std::ceil(side) + 15) / 16 * 16;
+        return std::max(t, 32);
+    }
+
+    WorkStealingPool& pool;
+    int fixedTileSize;
+    int tileSize = 0, tilesX = 0, tilesY = 0;
+    std::vector<ShapeRef> candidates;
+    std::vector<std::vector<ShapeRef>> bins;
+};
@@ -0,0 +1,195 @@
+// Display list benchmark: repaints of one random scene drawn directly and
+// replayed from a DisplayList, through the TileRenderer.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. DisplayListBench.cpp -o display_list_bench
+//   ./display_list_bench [threads] [shapes-per-kind]
+//
+// Every replayed frame is compared with the direct one: whole frames, small
+// damaged areas, under a clip window and after it changes, after the canvas
+// grows, and with a budget too small for the scene. Any difference fails
+// the run.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include "../Scene.h"
+#include "../TileRenderer.h"
+
+static const int Width = 1920;
+static const int Height = 1080;
+static const int Frames = 5;
+static const COLORREF Background = RGB(255, 255, 255);
+
+static Scene MakeScene(int perKind) {
+    std::mt19937 rng(42);
+    auto rnd = [&](int lo, int hi) { return lo + (int)(rng() % (unsigned)(hi - lo + 1)); };
+    auto color = [&]() { return RGB(rnd(0, 255), rnd(0, 255), rnd(0, 255)); };
+    auto point = [&]() { return Point(rnd(0, Width - 1), rnd(0, Height - 1)); };
+
+    Scene scene;
+    for (int i = 0; i < perKind; i++) {
+        Point a = point();
+        Line l = { a.x, a.y, a.x + rnd(-300, 300), a.y + rnd(-300, 300), color(), i % 3 };
+        scene.Add(l);
+        scene.Add(point());
+
+        Circle c = { rnd(0, Width - 1), rnd(0, Height - 1), rnd(5, 120), color(), rnd(1, 4), i % 7 };
+        scene.Add(c);
+
+        Ellipsee e = { rnd(0, Width - 1), rnd(0, Height - 1), rnd(5, 150), rnd(5, 150), color(), 1, i % 3 };
+        scene.Add(e);
+
+        Point polygon[5];
+        for (Point& p : polygon) p = Point(a.x + rnd(-120, 120), a.y + rnd(-120, 120));
+        scene.AddPolygon(polygon, 5, a.x - 80, a.x + 80, a.y - 80, a.y + 80, color());
+
+        BezierCurve b = { point(), point(), point(), point(), color(), color(), color(), color() };
+        scene.Add(b);
+
+        HermiteCurve h = { a, Point(a.x + rnd(-200, 200), a.y + rnd(-200, 200)),
+            Point(rnd(-200, 200), rnd(-200, 200)), Point(rnd(-200, 200), rnd(-200, 200)), color() };
+        scene.Add(h);
+
+        Point control[5];
+        for (Point& p : control) p = Point(a.x + rnd(-150, 150), a.y + rnd(-150, 150));
+        scene.AddSpline(control, 5, rnd(0, 10) / 10.0, color());
+
+        const AdvancedKind kinds[] = { ADVANCED_SQUARE_HERMITE, ADVANCED_RECTANGLE_BEZIER, ADVANCED_EMPTY_SQUARE, ADVANCED_POLYGON_CONVEX };
+        AdvancedKind kind = kinds[i % 4];
+        Point corners[3] = { a, Point(a.x + rnd(-100, 100), a.y + rnd(-100, 100)) };
+        if (kind == ADVANCED_POLYGON_CONVEX) corners[2] = Point(a.x + rnd(-100, 100), a.y + rnd(-100, 100));
+        scene.AddAdvanced(kind, corners, kind == ADVANCED_POLYGON_CONVEX ? 3 : 2, color());
+    }
+    RefreshCurveOutlines(scene);
+    return scene;
+}
+
+static double TimeMs(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+struct Painter {
+    TileRenderer& renderer;
+    const Scene& scene;
+    std::vector<ShapeRef> all;
+
+    Painter(TileRenderer& renderer, const Scene& scene) : renderer(renderer), scene(scene) {
+        for (int k = 0; k < SHAPE_KIND_COUNT; k++)
+            for (int i = 0; i < ShapeCount(scene, (ShapeKind)k); i++) all.push_back(ShapeRef{ (ShapeKind)k, i });
+    }
+
+    // Best time of a few repaints of area, in ms.
+    double Paint(PixelBuffer& frame, const PixelRect& area, DisplayList* list, int frames = Frames) {
+        double best = 1e30;
+        for (int f = 0; f < frames; f++) {
+            auto t0 = std::chrono::steady_clock::now();
+            RenderTarget rt = ClipTarget(frame.Target(), area);
+            renderer.Render(rt, scene, all, Background, list);
+            best = std::min(best, TimeMs(t0, std::chrono::steady_clock::now()));
+        }
+        return best;
+    }
+};
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    int perKind = argc > 2 ? atoi(argv[2]) : 200;
+    if (threads < 1) threads = 1;
+
+    Scene scene = MakeScene(perKind);
+    WorkStealingPool pool(threads);
+    TileRenderer renderer(pool);
+    Painter painter(renderer, scene);
+    PixelBuffer direct(Width, Height), replayed(Width, Height);
+    PixelRect full = { 0, 0, Width, Height };
+    bool ok = true;
+    auto check = [&](const char* what) {
+        bool same = direct.pixels == replayed.pixels;
+        ok = ok && same;
+        if (!same) printf("%s: MISMATCH\n", what);
+    };
+
+    printf("%dx%d, %d shapes per kind, %d threads, best of %d frames\n", Width, Height, perKind, threads, Frames);
+    DisplayList list;
+    double directMs = painter.Paint(direct, full, nullptr);
+    printf("direct %10.2f ms\n", directMs);
+    // frames that still compile part of the scene
+    for (int f = 1;; f++) {
+        uint64_t deferred = list.Stats().deferred;
+        double ms = painter.Paint(replayed, full, &list, 1);
+        check("compiling frame");
+        DisplayListStats s = list.Stats();
+        printf("frame %d %9.2f ms (%llu entries compiled so far)\n", f, ms, (unsigned long long)s.compiled);
+        if (s.deferred == deferred) break;
+    }
+    double replayMs = painter.Paint(replayed, full, &list);
+    check("whole frame");
+    DisplayListStats s = list.Stats();
+    printf("replay %10.2f ms  x%5.2f, %zu entries in %.1f MB\n", replayMs, directMs / replayMs, s.entries,
+        s.bytes / 1048576.0);
+
+    // damaged areas of a few sizes, as WM_PAINT gets them
+    std::mt19937 rng(5);
+    for (int side : { 32, 128, 512 }) {
+        double d = 0, r = 0;
+        for (int i = 0; i < 20; i++) {
+            int x = (int)(rng() % (Width - side)), y = (int)(rng() % (Height - side));
+            PixelRect area = { x, y, x + side, y + side };
+            d += painter.Paint(direct, area, nullptr);
+            r += painter.Paint(replayed, area, &list);
+        }
+        check("damaged areas");
+        printf("%3d px areas: direct %7.3f ms, replay %7.3f ms\n", side, d / 20, r / 20);
+    }
+
+    // a clip window drops the line entries, and so does removing it
+    scene.currentClippingMethod = RECTANGLE;
+    scene.clippingEnabled = scene.clippingRectDrawn = true;
+    ClipRect window = { Width / 4, Height / 4, Width * 3 / 4, Height * 3 / 4 };
+    scene.clippingRect = window;
+    directMs = painter.Paint(direct, full, nullptr);
+    replayMs = painter.Paint(replayed, full, &list);
+    check("clip window");
+    printf("clipped: direct %7.2f ms, replay %7.2f ms (%llu compiled in all)\n", directMs, replayMs,
+        (unsigned long long)list.Stats().compiled);
+    scene.currentClippingMethod = None;
+    painter.Paint(direct, full, nullptr, 1);
+    painter.Paint(replayed, full, &list, 1);
+    check("clip window removed");
+
+    // entries compiled on a smaller canvas are redone once it grows
+    {
+        DisplayList small((size_t)64 << 20, 1e9);
+        PixelBuffer half(Width / 2, Height / 2);
+        painter.Paint(half, PixelRect{ 0, 0, Width / 2, Height / 2 }, &small, 1);
+        painter.Paint(replayed, full, &small, 1);
+        check("grown canvas");
+    }
+
+    // a budget of a quarter of the scene: repainting the frame a quarter at
+    // a time evicts the other quarters' entries, and the whole frame at once
+    // draws what does not fit directly
+    {
+        DisplayList tight(s.bytes / 4);
+        double quarterMs = 0;
+        for (int f = 0; f < 24; f++) {
+            int q = f % 4;
+            PixelRect area = { q % 2 * Width / 2, q / 2 * Height / 2, (q % 2 + 1) * Width / 2, (q / 2 + 1) * Height / 2 };
+            painter.Paint(direct, area, nullptr, 1);
+            double ms = painter.Paint(replayed, area, &tight, 1);
+            if (f >= 20) quarterMs += ms;
+        }
+        check("small budget, quarters");
+        for (int f = 0; f < 20; f++) painter.Paint(replayed, full, &tight, 1);
+        painter.Paint(direct, full, nullptr, 1);
+        replayMs = painter.Paint(replayed, full, &tight);
+        check("small budget");
+        DisplayListStats t = tight.Stats();
+        printf("budget %.1f MB: quarter %7.2f ms, frame %7.2f ms; %zu entries, %llu evicted, %llu drawn directly\n",
+            s.bytes / 4 / 1048576.0, quarterMs / 4, replayMs, t.entries, (unsigned long long)t.evicted,
+            (unsigned long long)t.direct);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+// Midpoint ellipse check and benchmark.
+//
+//   g++ -std=c++14 -O2 -I.. EllipseBench.cpp -o ellipse_bench
+//   ./ellipse_bench [max-axis]
+//
+// Two checks, either of which fails the run:
+//
+// - Every pair of axes up to 400, against a reference that evaluates the
+//   midpoint test afresh for each column (region 1) and each row (region 2)
+//   rather than stepping it. Both must give the same points.
+// - Random axes up to max-axis (default 10^5) and a few extreme shapes,
+//   against the true curve: each point lies within half a pixel of it
+//   along one axis, the points form an unbroken chain
+//   from (0, b) to (a, 0), and each pair of neighbours is 8-connected.
+//
+// Then the time to draw outlines pixel by pixel (Draw4Points), as spans
+// (MidpointEllipse) and filled (FillEllipseSpans) over a range of sizes,
+// centred on a 2048 x 2048 canvas.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../Raster.h"
+
+static std::vector<Point> Quadrant(int a, int b) {
+    std::vector<Point> pts;
+    MidpointEllipseQuadrant(a, b, [&](int x, int y) { pts.push_back(Point(x, y)); });
+    return pts;
+}
+
+// 4 F(x2 / 2, y2 / 2), exact for axes up to a few thousand.
+static long long F4(long long a, long long b, long long x2, long long y2) {
+    return b * b * x2 * x2 + a * a * y2 * y2 - 4 * a * a * b * b;
+}
+
+static std::vector<Point> Reference(int a, int b) {
+    std::vector<Point> pts;
+    if (b == 0) {
+        for (int x = 0; x <= a; x++) pts.push_back(Point(x, 0));
+        return pts;
+    }
+    // region 1: each column keeps the lowest row whose midpoint above is
+    // inside, while the outline is flatter than a diagonal
+    int x = 0, y = b;
+    pts.push_back(Point(x, y));
+    // or until the next column would drop two rows, which only a very
+    // thin ellipse does before its tangent point
+    while ((long long)b * b * x < (long long)a * a * y && F4(a, b, 2 * x + 2, 2 * y - 3) < 0) {
+        x++;
+        if (F4(a, b, 2 * x, 2 * y - 1) >= 0) y--;
+        pts.push_back(Point(x, y));
+    }
+    // region 2: each row moves right when the midpoint to the right is
+    // inside or on the outline
+    while (y > 0) {
+        y--;
+        if (F4(a, b, 2 * x + 1, 2 * y) <= 0) x++;
+        pts.push_back(Point(x, y));
+    }
+    // row 0 runs out to the tip
+    while (x < a) pts.push_back(Point(++x, 0));
+    return pts;
+}
+
+static bool SameAsReference(int maxAxis) {
+    for (int a = 0; a <= maxAxis; a++)
+        for (int b = 0; b <= maxAxis; b++) {
+            std::vector<Point> got = Quadrant(a, b), want = Reference(a, b);
+            bool same = got.size() == want.size();
+            for (size_t i = 0; same && i < got.size(); i++) same = got[i].x == want[i].x && got[i].y == want[i].y;
+            if (!same) {
+                printf("a=%d b=%d: %zu points, reference %zu\n", a, b, got.size(), want.size());
+                return false;
+            }
+        }
+    return true;
+}
+
+// Worst distance from the true curve, in pixels along whichever axis is
+// closer (the one the point's region steps is at most that); negative if
+// the points are not a connected chain from (0, b) to (a, 0).
+static double CurveError(int a, int b) {
+    std::vector<Point> pts = Quadrant(a, b);
+    if (pts.empty() || pts.front().x != 0 || pts.front().y != b || pts.back().x != a || pts.back().y != 0) return -1;
+    double A = a, B = b, worst = 0;
+    for (size_t i = 0; i < pts.size(); i++) {
+        const Point& p = pts[i];
+        if (i > 0) {
+            int dx = p.x - pts[i - 1].x, dy = pts[i - 1].y - p.y;
+            if (dx < 0 || dy < 0 || dx > 1 || dy > 1 || dx + dy == 0) return -1;
+        }
+        double rowErr = std::fabs(B * std::sqrt(std::max(0.0, 1 - (p.x / A) * (p.x / A))) - p.y);
+        double colErr = std::fabs(A * std::sqrt(std::max(0.0, 1 - (p.y / B) * (p.y / B))) - p.x);
+        worst = std::max(worst, std::min(rowErr, colErr));
+    }
+    return worst;
+}
+
+static bool NearCurve(int maxAxis) {
+    std::mt19937 rng(7);
+    std::vector<std::pair<int, int>> axes = { { maxAxis, maxAxis }, { maxAxis, 1 }, { 1, maxAxis },
+        { maxAxis, maxAxis / 3 }, { maxAxis - 1, maxAxis } };
+    for (int thin = 2; thin <= 16; thin++) {
+        axes.push_back({ maxAxis, thin });
+        axes.push_back({ thin, maxAxis });
+    }
+    for (int i = 0; i < 200; i++) axes.push_back({ 1 + (int)(rng() % maxAxis), 1 + (int)(rng() % maxAxis) });
+    double worst = 0;
+    for (auto& ab : axes) {
+        double err = CurveError(ab.first, ab.second);
+        // the 1e-6 covers sqrt rounding at exact half-pixel ties
+        if (err < 0 || err > 0.5 + 1e-6) {
+            printf("a=%d b=%d: %s\n", ab.first, ab.second, err < 0 ? "broken chain" : "off the curve");
+            return false;
+        }
+        worst = std::max(worst, err);
+    }
+    printf("%zu ellipses with axes up to %d: worst error %.4f px\n", axes.size(), maxAxis, worst);
+    return true;
+}
+
+template <class F>
+static double BestUs(F f, int repeats = 5) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int maxAxis = argc > 1 ? atoi(argv[1]) : 100000;
+    if (maxAxis < 4) maxAxis = 4;
+
+    bool exact = SameAsReference(400);
+    printf("axes 0..400 against the reference: %s\n", exact ? "same" : "DIFFERENT");
+    bool near = NearCurve(maxAxis);
+
+    const int Size = 2048;
+    PixelBuffer frame(Size, Size);
+    RenderTarget rt = frame.Target();
+    printf("\n%-8s %-8s %14s %14s %14s\n", "a", "b", "pixels us", "spans us", "filled us");
+    const int sizes[] = { 16, 256, 1000, 10000, 100000 };
+    for (int a : sizes) {
+        if (a > maxAxis) break;
+        int b = a / 3 + 1;
+        double pixels = BestUs([&] {
+            MidpointEllipseQuadrant(a, b, [&](int x, int y) { Draw4Points(rt, Size / 2, Size / 2, x, y, RGB(0, 0, 0)); });
+        });
+        double spans = BestUs([&] { MidpointEllipse(rt, Size / 2, Size / 2, a, b, RGB(0, 0, 0)); });
+        double filled = BestUs([&] { FillEllipseSpans(rt, Size / 2, Size / 2, a, b, 0, RGB(0, 0, 0)); });
+        printf("%-8d %-8d %14.1f %14.1f %14.1f\n", a, b, pixels, spans, filled);
+    }
+    return exact && near ? 0 : 1;
+}
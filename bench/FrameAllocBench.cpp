@@ -0,0 +1,123 @@
+// Heap allocations per repaint: renders a random scene the way WM_PAINT
+// does (a LayeredCanvas update, drawn by the TileRenderer with a
+// DisplayList, one ResetFrameArenas per frame) and counts every operator
+// new in the process.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. FrameAllocBench.cpp -o frame_alloc_bench
+//   ./frame_alloc_bench [threads] [shapes-per-kind] [frames]
+//
+// The first frames warm up the arenas and the renderer's reusable lists,
+// and last until the display list has compiled every shape; every frame
+// after that must allocate nothing, or the run fails.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <thread>
+#include "../Scene.h"
+#include "../SceneIndex.h"
+#include "../LayeredCanvas.h"
+
+static std::atomic<uint64_t> heapAllocations(0);
+
+void* operator new(size_t size) {
+    heapAllocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static const int Width = 1280;
+static const int Height = 720;
+static const int WarmupFrames = 2;
+static const COLORREF Background = RGB(255, 255, 255);
+
+static Scene MakeScene(int perKind) {
+    std::mt19937 rng(5);
+    auto rnd = [&](int lo, int hi) { return lo + (int)(rng() % (unsigned)(hi - lo + 1)); };
+    auto color = [&]() { return RGB(rnd(0, 255), rnd(0, 255), rnd(0, 255)); };
+    auto point = [&]() { return Point(rnd(0, Width - 1), rnd(0, Height - 1)); };
+
+    Scene scene;
+    for (int i = 0; i < perKind; i++) {
+        Point a = point();
+        Line l = { a.x, a.y, a.x + rnd(-300, 300), a.y + rnd(-300, 300), color(), i % 3 };
+        scene.Add(l);
+        scene.Add(point());
+        Circle c = { rnd(0, Width - 1), rnd(0, Height - 1), rnd(5, 120), color(), rnd(1, 4), i % 7 };
+        scene.Add(c);
+        Ellipsee e = { rnd(0, Width - 1), rnd(0, Height - 1), rnd(5, 150), rnd(5, 150), color(), 1, i % 3 };
+        scene.Add(e);
+        BezierCurve b = { point(), point(), point(), point(), color(), color(), color(), color() };
+        scene.Add(b);
+        HermiteCurve h = { a, Point(a.x + rnd(-200, 200), a.y + rnd(-200, 200)),
+            Point(rnd(-200, 200), rnd(-200, 200)), Point(rnd(-200, 200), rnd(-200, 200)), color() };
+        scene.Add(h);
+
+        Point control[5];
+        for (Point& p : control) p = Point(a.x + rnd(-150, 150), a.y + rnd(-150, 150));
+        scene.AddSpline(control, 5, rnd(0, 10) / 10.0, color());
+        scene.AddPolygon(control, 4, a.x - 60, a.x + 60, a.y - 60, a.y + 60, color());
+
+        const AdvancedKind kinds[] = { ADVANCED_SQUARE_HERMITE, ADVANCED_RECTANGLE_BEZIER, ADVANCED_EMPTY_SQUARE,
+            ADVANCED_POLYGON_CONVEX, ADVANCED_POLYGON_NONCONVEX };
+        AdvancedKind kind = kinds[i % 5];
+        int corners = kind == ADVANCED_POLYGON_CONVEX ? 3 : kind == ADVANCED_POLYGON_NONCONVEX ? 5 : 2;
+        scene.AddAdvanced(kind, control, corners, color());
+    }
+    // half the curves stay unflattened so the draw-time fallback runs too
+    for (int i = 0; i < scene.hermites.Size(); i += 2) RefreshCurveOutline(scene, HermiteHandle{ i });
+    for (int i = 0; i < scene.splines.Size(); i += 2) RefreshCurveOutline(scene, SplineHandle{ i });
+    scene.currentClippingMethod = RECTANGLE;
+    scene.clippingEnabled = scene.clippingRectDrawn = true;
+    scene.clippingRect = { Width / 8, Height / 8, Width * 7 / 8, Height * 7 / 8 };
+    return scene;
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    int perKind = argc > 2 ? atoi(argv[2]) : 300;
+    int frames = argc > 3 ? atoi(argv[3]) : 10;
+    if (threads < 1) threads = 1;
+    if (frames <= WarmupFrames) frames = WarmupFrames + 1;
+
+    Scene scene = MakeScene(perKind);
+    SceneIndex index;
+    index.Rebuild(scene);
+    WorkStealingPool pool(threads);
+    TileRenderer renderer(pool);
+    DisplayList displayList;
+    LayeredCanvas canvas(renderer, Background);
+    canvas.Resize(Width, Height);
+    PixelBuffer frame(Width, Height);
+    // a full repaint and a small damaged area on each layer
+    const PixelRect areas[] = { { 0, 0, Width, Height }, { Width / 3, Height / 3, Width / 3 + 200, Height / 3 + 150 } };
+
+    printf("%dx%d, %d shapes per kind, %d thread(s)\n", Width, Height, perKind, threads);
+    printf("%-6s %12s %10s %16s %14s\n", "frame", "heap allocs", "ms", "arena chunks", "arena peak KB");
+    uint64_t steady = 0;
+    int warmup = WarmupFrames;
+    for (int f = 0; f < frames + warmup - WarmupFrames; f++) {
+        uint64_t before = heapAllocations.load(), compiled = displayList.Stats().compiled;
+        auto t0 = std::chrono::steady_clock::now();
+        ResetFrameArenas();
+        for (const PixelRect& area : areas) {
+            for (int l = 0; l < LAYER_COUNT; l++) canvas.Invalidate((CanvasLayer)l, area);
+            canvas.Update(scene, index, &displayList, frame);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        uint64_t allocs = heapAllocations.load() - before;
+        FrameArenaStats arena = FrameArenaTotals();
+        if (f >= warmup - 1 && displayList.Stats().compiled != compiled) warmup = f + 2;
+        if (f >= warmup) steady += allocs;
+        printf("%-6d %12llu %10.2f %16llu %14.1f%s\n", f, (unsigned long long)allocs, ms,
+            (unsigned long long)arena.heapAllocations, arena.peak / 1024.0, f < warmup ? "  (warm-up)" : "");
+    }
+    printf("steady-state heap allocations: %llu\n", (unsigned long long)steady);
+    return steady == 0 ? 0 : 1;
+}
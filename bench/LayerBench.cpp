@@ -0,0 +1,256 @@
+// Layered canvas benchmark: what a repaint costs when only the background,
+// the clip window or a small area changed, next to redrawing the frame, and
+// how many flood fills each change traces again.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. LayerBench.cpp -o layer_bench
+//   ./layer_bench [threads] [shapes-per-kind]
+//
+// The scene holds a grid of small squares with a flood fill in each, and a
+// large square with one more. After every change the composite is compared with the
+// frame drawn the plain way: the background, each fill traced afresh on
+// the shapes but the points, those shapes, then the clip outline and the
+// points. Any difference fails the run.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <thread>
+#include "../Scene.h"
+#include "../FloodFill.h"
+#include "../LayeredCanvas.h"
+
+static const int Width = 1920;
+static const int Height = 1080;
+static const int Frames = 5;
+
+static Scene MakeScene(int perKind) {
+    std::mt19937 rng(42);
+    auto rnd = [&](int lo, int hi) { return lo + (int)(rng() % (unsigned)(hi - lo + 1)); };
+    auto color = [&]() { return RGB(rnd(0, 255), rnd(0, 255), rnd(0, 255)); };
+    auto point = [&]() { return Point(rnd(0, Width - 1), rnd(0, Height - 1)); };
+
+    Scene scene;
+    for (int i = 0; i < perKind; i++) {
+        Point a = point();
+        Line l = { a.x, a.y, a.x + rnd(-300, 300), a.y + rnd(-300, 300), color(), i % 3 };
+        scene.Add(l);
+        scene.Add(point());
+        Circle c = { rnd(0, Width - 1), rnd(0, Height - 1), rnd(5, 120), color(), rnd(1, 4), i % 7 };
+        scene.Add(c);
+        Ellipsee e = { rnd(0, Width - 1), rnd(0, Height - 1), rnd(5, 150), rnd(5, 150), color(), 1, i % 3 };
+        scene.Add(e);
+        BezierCurve b = { point(), point(), point(), point(), color(), color(), color(), color() };
+        scene.Add(b);
+        Point corners[2] = { a, Point(a.x + rnd(-100, 100), a.y + rnd(-100, 100)) };
+        scene.AddAdvanced(i % 2 ? ADVANCED_EMPTY_SQUARE : ADVANCED_RECTANGLE_BEZIER, corners, 2, color());
+    }
+    // squares drawn over the rest, so nothing breaks their outlines, each
+    // filled from its centre
+    std::vector<COLORREF> outlines;
+    for (int gy = 0; gy < 10; gy++)
+        for (int gx = 0; gx < 20; gx++) {
+            Point square[2] = { Point(gx * 96 + 28, gy * 108 + 34), Point(gx * 96 + 68, gy * 108 + 74) };
+            outlines.push_back(color());
+            scene.AddAdvanced(ADVANCED_EMPTY_SQUARE, square, 2, outlines.back());
+        }
+    // a large one around the centre, drawn last and red like the points
+    Point box[2] = { Point(Width / 2 - 200, Height / 2 - 200), Point(Width / 2 + 200, Height / 2 + 200) };
+    scene.AddAdvanced(ADVANCED_EMPTY_SQUARE, box, 2, RGB(255, 0, 0));
+    RefreshCurveOutlines(scene);
+
+    for (int i = 0; i < (int)outlines.size(); i++) {
+        Point seed(i % 20 * 96 + 48, i / 20 * 108 + 54);
+        scene.AddFloodFill(i % 2 ? ADVANCED_FLOOD_RECURSIVE : ADVANCED_FLOOD_NONRECURSIVE, seed, color(), outlines[i]);
+    }
+    scene.AddFloodFill(ADVANCED_FLOOD_NONRECURSIVE, Point(Width / 2, Height / 2), RGB(0, 200, 120), RGB(255, 0, 0));
+    return scene;
+}
+
+static double TimeMs(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// The frame without layers: the fills in the order added, each traced on
+// the shapes but the points, under those shapes, and the overlay on top.
+static void Reference(const Scene& scene, COLORREF background, PixelBuffer& out) {
+    static PixelBuffer geometry, fills;
+    geometry.Resize(Width, Height);
+    fills.Resize(Width, Height);
+    std::fill(geometry.pixels.begin(), geometry.pixels.end(), TransparentPixel);
+    std::fill(fills.pixels.begin(), fills.pixels.end(), TransparentPixel);
+    RenderTarget g = geometry.Target();
+    ClipWindow w = ActiveClipWindow(scene);
+    for (int k = 0; k < SHAPE_KIND_COUNT; k++)
+        for (int i = 0; i < ShapeCount(scene, (ShapeKind)k); i++)
+            if (k != SHAPE_POINTS) DrawShape(g, scene, w, ShapeRef{ (ShapeKind)k, i });
+    ScanlineFloodFill tracer;
+    std::vector<FloodRun> runs;
+    const AdvancedTable& a = scene.advanced;
+    for (int i = 0; i < a.Size(); i++) {
+        if (!IsFloodFill(a.kind[i])) continue;
+        Point seed = scene.Vertices(a.points[i])[0];
+        runs.clear();
+        tracer.Trace(g, seed.x, seed.y, a.color[i], a.boundary[i], runs);
+        for (const FloodRun& r : runs)
+            for (int x = r.x1; x <= r.x2; x++) fills.pixels[(size_t)r.y * Width + x] = ToPixel(a.color[i]);
+    }
+
+    out.Clear(background);
+    for (size_t i = 0; i < out.pixels.size(); i++) {
+        if (fills.pixels[i] != TransparentPixel) out.pixels[i] = fills.pixels[i];
+        if (geometry.pixels[i] != TransparentPixel) out.pixels[i] = geometry.pixels[i];
+    }
+    RenderTarget rt = out.Target();
+    DrawClipOutline(rt, scene, w);
+    for (int i = 0; i < scene.points.Size(); i++) DrawShape(rt, scene, w, ShapeRef{ SHAPE_POINTS, i });
+}
+
+// Fills traced and replayed since the last call.
+static FillStats FillsSince(const LayeredCanvas& canvas, FillStats& last) {
+    FillStats now = canvas.Stats(), d;
+    d.traced = now.traced - last.traced;
+    d.replayed = now.replayed - last.replayed;
+    last = now;
+    return d;
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    int perKind = argc > 2 ? atoi(argv[2]) : 200;
+    if (threads < 1) threads = 1;
+
+    Scene scene = MakeScene(perKind);
+    SceneIndex index;
+    index.Rebuild(scene);
+    WorkStealingPool pool(threads);
+    TileRenderer renderer(pool);
+    DisplayList list;
+    COLORREF background = RGB(255, 255, 255);
+    LayeredCanvas canvas(renderer, background);
+    canvas.Resize(Width, Height);
+    PixelBuffer frame(Width, Height), reference(Width, Height);
+    int fillCount = 0;
+    for (int i = 0; i < scene.advanced.Size(); i++) fillCount += IsFloodFill(scene.advanced.kind[i]);
+
+    bool ok = true;
+    auto check = [&](const char* what) {
+        Reference(scene, background, reference);
+        bool same = frame.pixels == reference.pixels;
+        ok = ok && same;
+        if (!same) printf("%s: MISMATCH\n", what);
+    };
+    // best of a few updates, each after change() marks what it changes
+    auto time = [&](std::function<void()> change) {
+        double best = 1e30;
+        for (int f = 0; f < Frames; f++) {
+            change();
+            auto t0 = std::chrono::steady_clock::now();
+            canvas.Update(scene, index, &list, frame);
+            best = std::min(best, TimeMs(t0, std::chrono::steady_clock::now()));
+        }
+        return best;
+    };
+
+    printf("%dx%d, %d shapes per kind, %d fills, %d threads, best of %d updates\n", Width, Height, perKind, fillCount,
+        threads, Frames);
+    // let the display list fill up first, as a long session would
+    for (uint64_t deferred = ~0ull; list.Stats().deferred != deferred;) {
+        deferred = list.Stats().deferred;
+        canvas.SceneChanged();
+        canvas.Update(scene, index, &list, frame);
+    }
+    FillStats last = canvas.Stats(), d;
+    double every = time([&] { canvas.SceneChanged(); });
+    check("whole frame");
+    d = FillsSince(canvas, last);
+    printf("every layer  %8.2f ms  (%llu fills traced)\n", every, (unsigned long long)d.traced / Frames);
+
+    double nothing = time([] {});
+    printf("nothing      %8.2f ms\n", nothing);
+
+    // the fills layer alone, repainted from the runs kept
+    double replay = time([&] { canvas.InvalidateAll(LAYER_FILLS); });
+    check("fills replayed");
+    d = FillsSince(canvas, last);
+    printf("fills        %8.2f ms  (%llu traced, %llu replayed)\n", replay, (unsigned long long)d.traced / Frames,
+        (unsigned long long)d.replayed / Frames);
+
+    // a line across the red square: only the fills it touches are traced
+    {
+        Point c(Width / 2, Height / 2);
+        Line l = { c.x - 150, c.y - 120, c.x + 150, c.y - 80, RGB(0, 0, 255), 0 };
+        ShapeRef ref = scene.Add(l);
+        PixelRect bounds = ShapeBounds(scene, ref);
+        index.Insert(ref, bounds);
+        canvas.Invalidate(LAYER_GEOMETRY, bounds);
+        auto t0 = std::chrono::steady_clock::now();
+        canvas.Update(scene, index, &list, frame);
+        double ms = TimeMs(t0, std::chrono::steady_clock::now());
+        check("line over a fill");
+        d = FillsSince(canvas, last);
+        printf("line added   %8.2f ms  (%llu traced, %llu replayed)\n", ms, (unsigned long long)d.traced,
+            (unsigned long long)d.replayed);
+    }
+
+    double bg = time([&] {
+        background = background == RGB(255, 255, 255) ? RGB(250, 240, 220) : RGB(255, 255, 255);
+        canvas.SetBackground(background);
+    });
+    check("background");
+    d = FillsSince(canvas, last);
+    printf("background   %8.2f ms  (%llu traced)\n", bg, (unsigned long long)d.traced);
+
+    // a clip window: the overlay and the lines
+    scene.currentClippingMethod = RECTANGLE;
+    scene.clippingEnabled = scene.clippingRectDrawn = true;
+    std::mt19937 rng(5);
+    double clip = time([&] {
+        int x = (int)(rng() % (Width / 2)), y = (int)(rng() % (Height / 2));
+        scene.clippingRect = ClipRect{ x, y, x + Width / 3, y + Height / 3 };
+        canvas.ClipWindowChanged(scene);
+    });
+    check("clip window");
+    d = FillsSince(canvas, last);
+    printf("clip window  %8.2f ms  (%llu traced per move)\n", clip, (unsigned long long)d.traced / Frames);
+
+    // the window nudged a few pixels: only the lines across its edges change
+    double nudge = time([&] {
+        ClipRect& r = scene.clippingRect;
+        int dx = (int)(rng() % 17) - 8;
+        r = ClipRect{ r.left + dx, r.top, r.right + dx, r.bottom };
+        canvas.ClipWindowChanged(scene);
+    });
+    check("clip window nudged");
+    d = FillsSince(canvas, last);
+    printf("clip nudge   %8.2f ms  (%llu traced per move)\n", nudge, (unsigned long long)d.traced / Frames);
+
+    for (int side : { 32, 128 }) {
+        double area = time([&] {
+            int x = (int)(rng() % (Width - side)), y = (int)(rng() % (Height - side));
+            canvas.Invalidate(LAYER_GEOMETRY, PixelRect{ x, y, x + side, y + side });
+        });
+        check("damaged area");
+        d = FillsSince(canvas, last);
+        printf("%3d px area  %8.2f ms  (%.1f traced per area)\n", side, area, (double)d.traced / Frames);
+    }
+
+    scene.currentClippingMethod = None;
+    canvas.ClipWindowChanged(scene);
+    canvas.Update(scene, index, &list, frame);
+    check("clip window removed");
+
+    // the whole frame without layers, as WM_PAINT drew it before
+    std::vector<ShapeRef> all;
+    double direct = 1e30;
+    for (int f = 0; f < Frames; f++) {
+        auto t0 = std::chrono::steady_clock::now();
+        index.Query(PixelRect{ 0, 0, Width, Height }, all);
+        RenderTarget rt = reference.Target();
+        renderer.Render(rt, scene, all, background, &list);
+        direct = std::min(direct, TimeMs(t0, std::chrono::steady_clock::now()));
+    }
+    printf("no layers    %8.2f ms\n", direct);
+    return ok ? 0 : 1;
+}
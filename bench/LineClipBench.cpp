@@ -0,0 +1,86 @@
+// Line clipping benchmark: ClipLine one line at a time against the batch
+// ClipLines, on 10^6 random lines and a few windows.
+//
+//   g++ -std=c++14 -O2 -I.. LineClipBench.cpp -o lineclip_bench          (SSE2)
+//   g++ -std=c++14 -O2 -mavx2 -I.. LineClipBench.cpp -o lineclip_bench  (AVX2)
+//   ./lineclip_bench [lines]
+//
+// Both paths must keep the same lines with the same end points; any
+// difference is reported and fails the run.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "../LineClip.h"
+
+static const int Canvas = 2000;
+
+static double Ms(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+static const char* SimdPath() {
+#if LINECLIP_AVX2
+    return "AVX2";
+#elif LINECLIP_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+// Lines with both ends anywhere on a canvas a bit larger than the windows,
+// plus some short ones so that whole blocks fall inside.
+static LineArrays MakeLines(int count) {
+    std::mt19937 rng(7);
+    auto rnd = [&](int lo, int hi) { return lo + (int)(rng() % (unsigned)(hi - lo + 1)); };
+    LineArrays lines;
+    for (int i = 0; i < count; i++) {
+        int x = rnd(-Canvas / 4, Canvas + Canvas / 4), y = rnd(-Canvas / 4, Canvas + Canvas / 4);
+        if (i % 4 == 0) lines.Push(x, y, x + rnd(-20, 20), y + rnd(-20, 20));
+        else lines.Push(x, y, rnd(-Canvas / 4, Canvas + Canvas / 4), rnd(-Canvas / 4, Canvas + Canvas / 4));
+    }
+    return lines;
+}
+
+static bool Same(const ClippedLines& a, const ClippedLines& b) {
+    return a.source == b.source && a.lines.x1 == b.lines.x1 && a.lines.y1 == b.lines.y1 &&
+        a.lines.x2 == b.lines.x2 && a.lines.y2 == b.lines.y2;
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (count < 1) count = 1;
+    LineArrays lines = MakeLines(count);
+
+    struct { const char* name; ClipWindow w; } windows[] = {
+        { "small", { 800, 800, 1200, 1200 } },
+        { "half", { 500, 500, 1500, 1500 } },
+        { "canvas", { 0, 0, Canvas - 1, Canvas - 1 } },
+    };
+
+    printf("%d lines, batch path: %s\n", count, SimdPath());
+    printf("%-8s %10s %12s %12s %9s %12s\n", "window", "kept", "ClipLine ms", "ClipLines ms", "speedup", "Mlines/s");
+    bool ok = true;
+    ClippedLines single, batch;
+    for (auto& win : windows) {
+        const int Repeats = 5;
+        double bestSingle = 1e30, bestBatch = 1e30;
+        for (int r = 0; r < Repeats; r++) {
+            auto t0 = std::chrono::steady_clock::now();
+            single.Clear();
+            ClipLinesScalar(win.w, lines, 0, single);
+            auto t1 = std::chrono::steady_clock::now();
+            ClipLines(win.w, lines, batch);
+            auto t2 = std::chrono::steady_clock::now();
+            bestSingle = std::min(bestSingle, Ms(t0, t1));
+            bestBatch = std::min(bestBatch, Ms(t1, t2));
+        }
+        bool same = Same(single, batch);
+        ok = ok && same;
+        printf("%-8s %10zu %12.2f %12.2f %8.2fx %12.1f%s\n", win.name, batch.Size(), bestSingle, bestBatch,
+            bestSingle / bestBatch, count / bestBatch / 1e3, same ? "" : "  MISMATCH");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,419 @@
+// Rasterization microbenchmarks: every line, circle, ellipse, curve,
+// polygon fill, polygon clip and flood fill routine, each over a sweep of
+// its main parameter (radius, slope, length, control-point spread, vertex
+// count, region size).
+//
+//   g++ -std=c++14 -O2 -I.. RasterBench.cpp -o raster_bench
+//   ./raster_bench [--filter TEXT] [--min-ms N] [--json FILE] [--csv FILE]
+//
+// For each case the table shows the time per call, the pixels the call
+// sets (counted once on a blank canvas), ns per pixel, pixels per second
+// and the heap allocations per call. --json and --csv write the same rows
+// for comparing two builds.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "../Raster.h"
+#include "../FloodFill.h"
+#include "../Scene.h"
+
+// Every heap allocation in the process goes through these.
+static std::atomic<unsigned long long> allocCount{ 0 };
+static std::atomic<unsigned long long> allocBytes{ 0 };
+
+static void* CountedAlloc(size_t n) {
+    allocCount++;
+    allocBytes += n;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t n) { return CountedAlloc(n); }
+void* operator new[](size_t n) { return CountedAlloc(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+static const int CanvasSize = 1100;
+static const int Center = CanvasSize / 2;
+static const COLORREF Background = RGB(255, 255, 255);
+static const COLORREF Ink = RGB(0, 0, 0);
+static const COLORREF FillColor = RGB(0, 128, 255);
+static const double Pi = 3.14159265358979323846;
+
+// FloodFillRecursive needs one stack frame per pixel.
+static const int RecursiveMaxRadius = 100;
+
+struct BenchCase {
+    std::string group, algorithm, param;
+    int value;
+    std::function<void(RenderTarget&)> draw;
+    // Flood fills change what the next call sees: the canvas is restored
+    // from `setup` before every call, outside the timed region.
+    std::function<void(RenderTarget&)> setup;
+};
+
+struct BenchResult {
+    const BenchCase* c;
+    double nsPerCall;
+    long long pixels;
+    double allocsPerCall, bytesPerCall;
+};
+
+static double NowNs() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static long long CountInk(const PixelBuffer& buf) {
+    uint32_t bg = ToPixel(Background);
+    long long n = 0;
+    for (uint32_t p : buf.pixels) n += p != bg;
+    return n;
+}
+
+class BenchRunner {
+public:
+    explicit BenchRunner(double minMs) : minNs(minMs * 1e6), canvas(CanvasSize, CanvasSize), prepared(CanvasSize, CanvasSize) {}
+
+    BenchResult Run(const BenchCase& c) {
+        BenchResult r = { &c, 0, 0, 0, 0 };
+
+        // pixels: one call on a blank (or freshly prepared) canvas
+        Prepare(c);
+        Restore();
+        {
+            RenderTarget rt = canvas.Target();
+            c.draw(rt);
+            r.pixels = c.setup ? ChangedPixels() : CountInk(canvas);
+        }
+
+        // allocations: one more call
+        Restore();
+        unsigned long long a0 = allocCount, b0 = allocBytes;
+        {
+            RenderTarget rt = canvas.Target();
+            c.draw(rt);
+        }
+        r.allocsPerCall = (double)(allocCount - a0);
+        r.bytesPerCall = (double)(allocBytes - b0);
+
+        // time: grow the batch until it lasts minNs, best of 3 batches
+        long long calls = 1;
+        double best = 1e300;
+        for (;;) {
+            double ns = TimeBatch(c, calls);
+            if (ns >= minNs) {
+                best = ns / calls;
+                for (int rep = 0; rep < 2; rep++) best = std::min(best, TimeBatch(c, calls) / calls);
+                break;
+            }
+            calls = ns > 0 ? std::max(calls * 2, (long long)(calls * minNs / ns * 1.2)) : calls * 16;
+        }
+        r.nsPerCall = best;
+        return r;
+    }
+
+private:
+    void Prepare(const BenchCase& c) {
+        prepared.Clear(Background);
+        if (c.setup) {
+            RenderTarget rt = prepared.Target();
+            c.setup(rt);
+        }
+    }
+
+    void Restore() { std::memcpy(canvas.pixels.data(), prepared.pixels.data(), canvas.pixels.size() * 4); }
+
+    long long ChangedPixels() const {
+        long long n = 0;
+        for (size_t i = 0; i < canvas.pixels.size(); i++) n += canvas.pixels[i] != prepared.pixels[i];
+        return n;
+    }
+
+    double TimeBatch(const BenchCase& c, long long calls) {
+        RenderTarget rt = canvas.Target();
+        if (!c.setup) {
+            double t0 = NowNs();
+            for (long long i = 0; i < calls; i++) c.draw(rt);
+            return NowNs() - t0;
+        }
+        double total = 0;
+        for (long long i = 0; i < calls; i++) {
+            Restore();
+            double t0 = NowNs();
+            c.draw(rt);
+            total += NowNs() - t0;
+        }
+        return total;
+    }
+
+    double minNs;
+    PixelBuffer canvas, prepared;
+};
+
+
+static std::vector<Point> RegularPolygon(int n, int cx, int cy, int r) {
+    std::vector<Point> p;
+    for (int i = 0; i < n; i++) {
+        double a = 2 * Pi * i / n;
+        p.push_back(Point(cx + Round(r * std::cos(a)), cy + Round(r * std::sin(a))));
+    }
+    return p;
+}
+
+// Non-convex: alternates between the outer and an inner radius.
+static std::vector<Point> StarPolygon(int n, int cx, int cy, int r) {
+    std::vector<Point> p;
+    for (int i = 0; i < n; i++) {
+        double a = 2 * Pi * i / n;
+        int ri = i % 2 ? r / 2 : r;
+        p.push_back(Point(cx + Round(ri * std::cos(a)), cy + Round(ri * std::sin(a))));
+    }
+    return p;
+}
+
+struct BenchLines {
+    std::vector<int> x1, y1, x2, y2, algorithm;
+    std::vector<COLORREF> color;
+};
+
+static std::vector<BenchCase> MakeCases() {
+    std::vector<BenchCase> cases;
+    auto add = [&](const char* group, const char* algorithm, const char* param, int value,
+        std::function<void(RenderTarget&)> draw, std::function<void(RenderTarget&)> setup = nullptr) {
+        BenchCase c = { group, algorithm, param, value, draw, setup };
+        cases.push_back(c);
+    };
+
+    // Lines: slope sweep at length 512 (rise over run in percent, 100000
+    // meaning vertical), then a length sweep at slope 1/2.
+    typedef void (*LineFn)(RenderTarget&, int, int, int, int, COLORREF);
+    const struct { const char* name; LineFn fn; } lineAlgs[] = {
+        { "DrawLineDDA", DrawLineDDA }, { "DrawLineBres", DrawLineBres }, { "ParametricLine", ParametricLine } };
+    for (auto& alg : lineAlgs) {
+        LineFn fn = alg.fn;
+        const int slopes[] = { 0, 25, 100, 400, 100000 };
+        for (int s : slopes) {
+            double a = s >= 100000 ? Pi / 2 : std::atan(s / 100.0);
+            int dx = Round(512 * std::cos(a)), dy = Round(512 * std::sin(a));
+            add("line", alg.name, "slope_pct", s, [=](RenderTarget& rt) { fn(rt, 20, 20, 20 + dx, 20 + dy, Ink); });
+        }
+        const int lengths[] = { 16, 128, 1024 };
+        for (int len : lengths) {
+            int dx = Round(len * 2 / std::sqrt(5.0)), dy = dx / 2;
+            add("line", alg.name, "length", len, [=](RenderTarget& rt) { fn(rt, 20, 20, 20 + dx, 20 + dy, Ink); });
+        }
+    }
+
+    // Line batches: random lines of every algorithm, half of them running
+    // off the canvas, drawn with one DrawLines call
+    const int batchSizes[] = { 100, 1000 };
+    for (int count : batchSizes) {
+        auto lines = std::make_shared<BenchLines>();
+        unsigned seed = 1;
+        auto rnd = [&](int lo, int hi) { seed = seed * 1103515245 + 12345; return lo + (int)((seed >> 8) % (unsigned)(hi - lo + 1)); };
+        for (int i = 0; i < count; i++) {
+            int reach = i % 2 ? CanvasSize / 2 : 0;
+            lines->x1.push_back(rnd(-reach, CanvasSize - 1 + reach));
+            lines->y1.push_back(rnd(-reach, CanvasSize - 1 + reach));
+            lines->x2.push_back(rnd(-reach, CanvasSize - 1 + reach));
+            lines->y2.push_back(rnd(-reach, CanvasSize - 1 + reach));
+            lines->algorithm.push_back(i % 3);
+            lines->color.push_back(Ink);
+        }
+        add("line", "DrawLines", "count", count, [=](RenderTarget& rt) {
+            const BenchLines& l = *lines;
+            LineBatch b = { l.x1.data(), l.y1.data(), l.x2.data(), l.y2.data(), l.algorithm.data(), l.color.data(),
+                nullptr, l.x1.size() };
+            DrawLines(rt, b);
+        });
+    }
+
+    // Circles: radius sweep
+    typedef void (*CircleFn)(RenderTarget&, int, int, int, COLORREF);
+    const struct { const char* name; CircleFn fn; } circleAlgs[] = {
+        { "CircleDirect", CircleDirect }, { "CirclePolar", CirclePolar }, { "CircleIterativePolar", CircleIterativePolar },
+        { "CircleMidpoint", CircleMidpoint }, { "CircleModifiedMidpoint", CircleModifiedMidpoint } };
+    const int radii[] = { 8, 32, 128, 512 };
+    for (auto& alg : circleAlgs) {
+        CircleFn fn = alg.fn;
+        for (int r : radii) add("circle", alg.name, "radius", r, [=](RenderTarget& rt) { fn(rt, Center, Center, r, Ink); });
+    }
+    // The same outlines replayed from the OutlineCache, and many circles of
+    // one size at scattered centres drawn either way
+    for (int i = 0; i < 5; i++) {
+        std::string name = std::string(circleAlgs[i].name) + "/cached";
+        CircleFn fn = circleAlgs[i].fn;
+        for (int r : radii)
+            add("circle", name.c_str(), "radius", r, [=](RenderTarget& rt) { DrawCircleOutline(rt, i, Center, Center, r, Ink); });
+        const int counts[] = { 100, 1000 };
+        for (int count : counts) {
+            add("circles", circleAlgs[i].name, "count", count, [=](RenderTarget& rt) {
+                for (int k = 0; k < count; k++) fn(rt, 40 + k * 37 % (CanvasSize - 80), 40 + k * 101 % (CanvasSize - 80), 24, Ink);
+            });
+            add("circles", name.c_str(), "count", count, [=](RenderTarget& rt) {
+                for (int k = 0; k < count; k++)
+                    DrawCircleOutline(rt, i, 40 + k * 37 % (CanvasSize - 80), 40 + k * 101 % (CanvasSize - 80), 24, Ink);
+            });
+        }
+    }
+    for (int r : radii) {
+        add("circle", "FillCircleWithLines", "radius", r, [=](RenderTarget& rt) { FillCircleWithLines(rt, Center, Center, r, 1, Ink); });
+        add("circle", "FillCircleWithCircles", "radius", r, [=](RenderTarget& rt) { FillCircleWithCircles(rt, Center, Center, r, 1, Ink); });
+    }
+
+    // Ellipses: a sweeps, b = a / 2
+    typedef void (*EllipseFn)(RenderTarget&, int, int, int, int, COLORREF);
+    const struct { const char* name; EllipseFn fn; } ellipseAlgs[] = {
+        { "ellipseDirect", ellipseDirect }, { "ellipsePolar", ellipsePolar }, { "MidpointEllipse", MidpointEllipse } };
+    for (auto& alg : ellipseAlgs) {
+        EllipseFn fn = alg.fn;
+        const int as[] = { 16, 64, 256 };
+        for (int a : as) add("ellipse", alg.name, "a", a, [=](RenderTarget& rt) { fn(rt, Center, Center, a, a / 2, Ink); });
+    }
+    for (int i = 0; i < 3; i++) {
+        std::string name = std::string(ellipseAlgs[i].name) + "/cached";
+        const int as[] = { 16, 64, 256 };
+        for (int a : as)
+            add("ellipse", name.c_str(), "a", a, [=](RenderTarget& rt) { DrawEllipseOutline(rt, i, Center, Center, a, a / 2, Ink); });
+    }
+
+    // Curves: control points spread over a square of the given side
+    const int spreads[] = { 16, 128, 512 };
+    for (int s : spreads) {
+        Point p0(Center - s / 2, Center + s / 2), p1(Center - s / 4, Center - s / 2);
+        Point p2(Center + s / 4, Center + s / 2), p3(Center + s / 2, Center - s / 2);
+        add("curve", "DrawBezierCurve", "spread", s, [=](RenderTarget& rt) {
+            DrawBezierCurve(rt, p0, Ink, p1, RGB(255, 0, 0), p2, RGB(0, 255, 0), p3, RGB(0, 0, 255));
+        });
+        Point t0(s, -s), t1(s, s);
+        add("curve", "DrawHermiteCurve", "spread", s, [=](RenderTarget& rt) { DrawHermiteCurve(rt, p0, p3, t0, t1, Ink); });
+        std::vector<Point> control;
+        for (int i = 0; i < 8; i++) control.push_back(Point(Center - s / 2 + s * i / 7, Center + (i % 2 ? s / 2 : -s / 2)));
+        add("curve", "DrawCardinalSpline", "spread", s, [=](RenderTarget& rt) { DrawCardinalSpline(rt, control.data(), 8, 0.5, Ink); });
+        // the same spline stroked from its cached outline, as repaints do
+        Scene scene;
+        RefreshCurveOutline(scene, scene.AddSpline(control.data(), 8, 0.5, Ink));
+        add("curve", "DrawSplineShape", "spread", s, [=](RenderTarget& rt) { DrawSplineShape(rt, scene, 0); });
+    }
+
+    // Polygon fills: vertex sweep over most of the canvas
+    const int vertexCounts[] = { 3, 8, 32, 128 };
+    for (int n : vertexCounts) {
+        std::vector<Point> convex = RegularPolygon(n, Center, Center, Center - 20);
+        std::vector<Point> star = StarPolygon(n < 4 ? 4 : n, Center, Center, Center - 20);
+        add("polygon", "ConvexFill", "vertices", n, [=](RenderTarget& rt) { ConvexFill(rt, convex.data(), (int)convex.size(), Ink); });
+        add("polygon", "GeneralPolygonFill", "vertices", n, [=](RenderTarget& rt) {
+            GeneralPolygonFill(rt, star.data(), (int)star.size(), Ink);
+        });
+        add("polygon", "GeneralPolygonFill-NZ", "vertices", n, [=](RenderTarget& rt) {
+            GeneralPolygonFill(rt, star.data(), (int)star.size(), Ink, FILL_NON_ZERO);
+        });
+    }
+
+    // Polygon clipping: the star outline against a window that cuts every
+    // point off
+    for (int n : vertexCounts) {
+        std::vector<Point> star = StarPolygon(n < 4 ? 4 : n, Center, Center, Center - 20);
+        int inset = CanvasSize / 4;
+        add("clip", "PolygonClip", "vertices", n, [=](RenderTarget& rt) {
+            PolygonClip(rt, star.data(), star.size(), inset, CanvasSize - inset, inset, CanvasSize - inset, Ink);
+        });
+    }
+
+    // Flood fills: the inside of a midpoint circle outline
+    const int regionRadii[] = { 16, 64, 100, 256 };
+    for (int r : regionRadii) {
+        auto outline = [=](RenderTarget& rt) { CircleMidpoint(rt, Center, Center, r, Ink); };
+        if (r <= RecursiveMaxRadius)
+            add("flood", "FloodFillRecursive", "radius", r, [=](RenderTarget& rt) { FloodFillRecursive(rt, Center, Center, FillColor, Ink); }, outline);
+        add("flood", "FloodFillNonRecursive", "radius", r, [=](RenderTarget& rt) { FloodFillNonRecursive(rt, Center, Center, FillColor, Ink); }, outline);
+        add("flood", "ScanlineFloodFill", "radius", r, [=](RenderTarget& rt) {
+            static ScanlineFloodFill filler;
+            filler.Fill(rt, Center, Center, FillColor, Ink);
+        }, outline);
+    }
+    return cases;
+}
+
+static void WriteJson(const char* path, const std::vector<BenchResult>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "cannot create %s\n", path); return; }
+    fprintf(f, "[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        double nsPerPixel = r.pixels ? r.nsPerCall / r.pixels : 0;
+        fprintf(f, "  {\"group\": \"%s\", \"algorithm\": \"%s\", \"param\": \"%s\", \"value\": %d, "
+            "\"ns_per_call\": %.1f, \"pixels\": %lld, \"ns_per_pixel\": %.3f, \"pixels_per_s\": %.0f, "
+            "\"allocs_per_call\": %.0f, \"alloc_bytes_per_call\": %.0f}%s\n",
+            r.c->group.c_str(), r.c->algorithm.c_str(), r.c->param.c_str(), r.c->value,
+            r.nsPerCall, r.pixels, nsPerPixel, nsPerPixel > 0 ? 1e9 / nsPerPixel : 0,
+            r.allocsPerCall, r.bytesPerCall, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "]\n");
+    fclose(f);
+}
+
+static void WriteCsv(const char* path, const std::vector<BenchResult>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) { fprintf(stderr, "cannot create %s\n", path); return; }
+    fprintf(f, "group,algorithm,param,value,ns_per_call,pixels,ns_per_pixel,pixels_per_s,allocs_per_call,alloc_bytes_per_call\n");
+    for (const BenchResult& r : results) {
+        double nsPerPixel = r.pixels ? r.nsPerCall / r.pixels : 0;
+        fprintf(f, "%s,%s,%s,%d,%.1f,%lld,%.3f,%.0f,%.0f,%.0f\n", r.c->group.c_str(), r.c->algorithm.c_str(),
+            r.c->param.c_str(), r.c->value, r.nsPerCall, r.pixels, nsPerPixel, nsPerPixel > 0 ? 1e9 / nsPerPixel : 0,
+            r.allocsPerCall, r.bytesPerCall);
+    }
+    fclose(f);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    const char* jsonPath = nullptr;
+    const char* csvPath = nullptr;
+    double minMs = 20;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--filter")) filter = argv[i + 1];
+        else if (!strcmp(argv[i], "--min-ms")) minMs = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "--json")) jsonPath = argv[i + 1];
+        else if (!strcmp(argv[i], "--csv")) csvPath = argv[i + 1];
+        else {
+            fprintf(stderr, "usage: raster_bench [--filter TEXT] [--min-ms N] [--json FILE] [--csv FILE]\n");
+            return 2;
+        }
+    }
+
+    std::vector<BenchCase> cases = MakeCases();
+    BenchRunner runner(minMs);
+    std::vector<BenchResult> results;
+
+    printf("%-8s %-24s %-9s %7s %12s %9s %9s %12s %8s\n", "group", "algorithm", "param", "value",
+        "ns/call", "pixels", "ns/pixel", "Mpixels/s", "allocs");
+    for (const BenchCase& c : cases) {
+        std::string name = c.group + "/" + c.algorithm;
+        if (filter && name.find(filter) == std::string::npos) continue;
+        BenchResult r = runner.Run(c);
+        results.push_back(r);
+        double nsPerPixel = r.pixels ? r.nsPerCall / r.pixels : 0;
+        printf("%-8s %-24s %-9s %7d %12.1f %9lld %9.2f %12.1f %8.0f\n", c.group.c_str(), c.algorithm.c_str(),
+            c.param.c_str(), c.value, r.nsPerCall, r.pixels, nsPerPixel, nsPerPixel > 0 ? 1e3 / nsPerPixel : 0,
+            r.allocsPerCall);
+        fflush(stdout);
+    }
+
+    if (jsonPath) WriteJson(jsonPath, results);
+    if (csvPath) WriteCsv(csvPath, results);
+    return 0;
+}
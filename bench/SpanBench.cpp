@@ -0,0 +1,117 @@
+// Span kernel benchmark: solid runs with every kernel set this CPU can run
+// (the layer compositing kernel is checked but not timed here), plus large
+// polygon and circle fills, next to a plain memset of the same bytes as the
+// memory-bandwidth yardstick.
+//
+//   g++ -std=c++14 -O2 -I.. SpanBench.cpp -o span_bench
+//   ./span_bench [width] [height]
+//
+// No -mavx2 is needed: the kernels carry their own target attributes. Every
+// kernel set must write exactly the pixels the scalar one does; any
+// difference is reported and fails the run.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "../Raster.h"
+
+static double Ms(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+template <class F>
+static double BestMs(F f, int repeats = 7) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, Ms(t0, std::chrono::steady_clock::now()));
+    }
+    return best;
+}
+
+// Runs of every length up to a few vectors, at every alignment, plus long
+// ones.
+static bool SameAsScalar(const SpanKernels& k) {
+    const SpanKernels& s = *SpanKernelsFor(SPAN_SCALAR);
+    std::mt19937 rng(3);
+    std::vector<uint32_t> a(4200), b(4200), src(4200);
+    for (int round = 0; round < 6000; round++) {
+        size_t offset = rng() % 16, n = round < 3000 ? round % 80 : rng() % 4096;
+        uint32_t c0 = rng() & 0xFFFFFF;
+        std::fill(a.begin(), a.end(), 0xABCDEF);
+        std::fill(b.begin(), b.end(), 0xABCDEF);
+        if (round % 2 == 0) {
+            s.fill(a.data() + offset, n, c0);
+            k.fill(b.data() + offset, n, c0);
+        } else {
+            // runs of drawn and transparent pixels, as a layer has them
+            for (size_t i = 0; i < src.size();) {
+                size_t run = 1 + rng() % 24;
+                bool drawn = rng() % 3 == 0;
+                for (; run > 0 && i < src.size(); run--, i++) src[i] = drawn ? (uint32_t)rng() & 0xFFFFFF : TransparentPixel;
+            }
+            s.over(a.data() + offset, src.data() + offset, n);
+            k.over(b.data() + offset, src.data() + offset, n);
+        }
+        if (a != b) return false;
+    }
+    return true;
+}
+
+// A 24-point star spanning the frame and a disc, both filled edge to edge.
+static void DrawShapes(RenderTarget& rt) {
+    const int Points = 24;
+    Point star[Points];
+    double cx = rt.width / 2.0, cy = rt.height / 2.0;
+    for (int i = 0; i < Points; i++) {
+        double a = i * 2 * 3.14159265358979 / Points, r = (i % 2 ? 0.45 : 0.95) * std::min(cx, cy);
+        star[i] = Point((int)(cx + r * std::cos(a) * rt.width / rt.height), (int)(cy + r * std::sin(a)));
+    }
+    GeneralPolygonFill(rt, star, Points, RGB(30, 90, 200));
+    FillCircleSpans(rt, (int)cx, (int)cy, (int)(std::min(cx, cy) * 0.4), 0, RGB(240, 200, 10));
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? atoi(argv[1]) : 3840;
+    int height = argc > 2 ? atoi(argv[2]) : 2160;
+    if (width < 16) width = 16;
+    if (height < 16) height = 16;
+    PixelBuffer frame(width, height);
+    RenderTarget rt = frame.Target();
+    double bytes = (double)width * height * 4;
+    SpanIsa best = DetectSpanIsa();
+
+    double memsetMs = BestMs([&] { memset(frame.pixels.data(), 0x55, (size_t)bytes); });
+    printf("%dx%d frame, detected %s; memset %.2f ms, %.1f GB/s\n", width, height,
+        SpanKernelsFor(best)->name, memsetMs, bytes / memsetMs / 1e6);
+    printf("%-7s %10s %10s %10s\n", "kernels", "fill ms", "fill GB/s", "shapes ms");
+
+    bool ok = true;
+    PixelBuffer reference(width, height);
+    for (int isa = SPAN_SCALAR; isa <= best; isa++) {
+        if (!UseSpanKernels((SpanIsa)isa)) continue;
+        const SpanKernels& k = ActiveSpanKernels();
+        bool same = SameAsScalar(k);
+
+        double fill = BestMs([&] {
+            for (int y = 0; y < height; y++) FillSpan(rt, 0, width - 1, y, RGB(10, 20, 30));
+        });
+        double shapes = BestMs([&] {
+            frame.Clear(RGB(255, 255, 255));
+            DrawShapes(rt);
+        });
+        // the whole frame after the last run
+        if (isa == SPAN_SCALAR) reference.pixels = frame.pixels;
+        else same = same && frame.pixels == reference.pixels;
+
+        ok = ok && same;
+        printf("%-7s %10.2f %10.1f %10.2f%s\n", k.name, fill, bytes / fill / 1e6, shapes,
+            same ? "" : "  MISMATCH");
+    }
+    UseSpanKernels(best);
+    return ok ? 0 : 1;
+}
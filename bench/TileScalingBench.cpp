@@ -0,0 +1,103 @@
+// Tile renderer scaling benchmark: renders one large random scene with the
+// serial DrawAllShapes and with TileRenderer on 1 to N threads.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. TileScalingBench.cpp -o tile_bench
+//   ./tile_bench [max-threads] [shapes-per-kind]
+//
+// Every parallel frame is compared with the serial one, so a speedup never
+// hides a pixel difference.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include "../Scene.h"
+#include "../TileRenderer.h"
+
+static const int Width = 1920;
+static const int Height = 1080;
+static const int Frames = 3;
+static const COLORREF Background = RGB(255, 255, 255);
+
+static Scene MakeScene(int perKind) {
+    std::mt19937 rng(42);
+    auto rnd = [&](int lo, int hi) { return lo + (int)(rng() % (unsigned)(hi - lo + 1)); };
+    auto color = [&]() { return RGB(rnd(0, 255), rnd(0, 255), rnd(0, 255)); };
+    auto point = [&]() { return Point(rnd(0, Width - 1), rnd(0, Height - 1)); };
+
+    Scene scene;
+    for (int i = 0; i < perKind; i++) {
+        Point a = point();
+        Line l = { a.x, a.y, a.x + rnd(-300, 300), a.y + rnd(-300, 300), color(), i % 3 };
+        scene.Add(l);
+
+        Circle c = { rnd(0, Width - 1), rnd(0, Height - 1), rnd(5, 120), color(), rnd(1, 4), i % 7 };
+        scene.Add(c);
+
+        Ellipsee e = { rnd(0, Width - 1), rnd(0, Height - 1), rnd(5, 150), rnd(5, 150), color(), 1, i % 3 };
+        scene.Add(e);
+
+        BezierCurve b = { point(), point(), point(), point(), color(), color(), color(), color() };
+        scene.Add(b);
+
+        HermiteCurve h = { a, Point(a.x + rnd(-200, 200), a.y + rnd(-200, 200)),
+            Point(rnd(-200, 200), rnd(-200, 200)), Point(rnd(-200, 200), rnd(-200, 200)), color() };
+        scene.Add(h);
+
+        Point control[5];
+        for (Point& p : control) p = Point(a.x + rnd(-150, 150), a.y + rnd(-150, 150));
+        double tension = rnd(0, 10) / 10.0;
+        scene.AddSpline(control, 5, tension, color());
+
+        const AdvancedKind kinds[] = { ADVANCED_SQUARE_HERMITE, ADVANCED_RECTANGLE_BEZIER, ADVANCED_EMPTY_SQUARE, ADVANCED_POLYGON_CONVEX };
+        AdvancedKind kind = kinds[i % 4];
+        COLORREF shapeColor = color();
+        Point corners[3] = { a, Point(a.x + rnd(-100, 100), a.y + rnd(-100, 100)) };
+        if (kind == ADVANCED_POLYGON_CONVEX) corners[2] = Point(a.x + rnd(-100, 100), a.y + rnd(-100, 100));
+        scene.AddAdvanced(kind, corners, kind == ADVANCED_POLYGON_CONVEX ? 3 : 2, shapeColor);
+    }
+    RefreshCurveOutlines(scene);
+    return scene;
+}
+
+static double TimeMs(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+int main(int argc, char** argv) {
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    int perKind = argc > 2 ? atoi(argv[2]) : 200;
+    if (maxThreads < 1) maxThreads = 1;
+
+    Scene scene = MakeScene(perKind);
+
+    PixelBuffer serial(Width, Height);
+    double serialMs = 1e30;
+    for (int f = 0; f < Frames; f++) {
+        auto t0 = std::chrono::steady_clock::now();
+        serial.Clear(Background);
+        RenderTarget rt = serial.Target();
+        DrawAllShapes(rt, scene);
+        serialMs = std::min(serialMs, TimeMs(t0, std::chrono::steady_clock::now()));
+    }
+    printf("%dx%d, %d shapes per kind, best of %d frames\n", Width, Height, perKind, Frames);
+    printf("%-8s %10.2f ms\n", "serial", serialMs);
+
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        WorkStealingPool pool(threads);
+        TileRenderer renderer(pool);
+        PixelBuffer tiled(Width, Height);
+        double best = 1e30;
+        for (int f = 0; f < Frames; f++) {
+            auto t0 = std::chrono::steady_clock::now();
+            RenderTarget rt = tiled.Target();
+            renderer.Render(rt, scene, Background);
+            best = std::min(best, TimeMs(t0, std::chrono::steady_clock::now()));
+        }
+        bool same = tiled.pixels == serial.pixels;
+        printf("%2d thr   %10.2f ms  x%5.2f vs serial%s\n", threads, best, serialMs / best,
+            same ? "" : "  MISMATCH");
+    }
+    return 0;
+}